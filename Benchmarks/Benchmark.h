@@ -0,0 +1,48 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+
+// Headless measurements of the engine's ECS, job system and transform code. Nothing here
+// creates a window or a D3D device, so the numbers are the engine code alone
+
+// How many times each measurement is repeated, the fastest run is reported
+#define BENCHMARK_RUNS 5
+
+// Milliseconds func takes, the fastest of runs tries so one slow run doesn't skew it
+template <class Func>
+double BestMilliseconds(int runs, Func func)
+{
+    double best = 1e30;
+    for (int i = 0; i < runs; i++)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        func();
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        if (elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+// Written with results nobody reads, so the compiler can't throw the work away
+extern volatile float benchmarkSink;
+
+// Benchmarks that double as tests count what went wrong here, main returns non zero if any did
+extern int benchmarkFailures;
+#define BENCHMARK_CHECK(condition) \
+    do { if (!(condition)) { benchmarkFailures++; printf("  FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition); } } while (0)
+
+// Each group prints its own results, main.cpp lists them
+void RunIterationBenchmarks();
+void RunChurnBenchmarks();
+void RunQueryBenchmarks();
+void RunSchedulerBenchmarks();
+void RunJobBenchmarks();
+void RunParallelForBenchmarks();
+void RunSpawnBenchmarks();
+void RunDrawOrderBenchmarks();
+void RunObserverBenchmarks();
+void RunTransformBenchmarks();
+void RunTransformSystemBenchmarks();
+void RunHierarchyBenchmarks();
+void RunRaycastBenchmarks();
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "Benchmark.h"
+#include "EntityManager.h"
+#include <vector>
+#include <algorithm>
+#include <random>
+
+using namespace ECS;
+
+// How many frames of churn each measurement averages over
+#define CHURN_FRAMES 20
+
+// The bookkeeping AddComponent and RemoveComponent used to do for each component type: a sorted
+// list of entity ids, re-sorted after every add and searched and erased from on every remove
+struct LegacyIndex
+{
+    std::vector<int> ids;
+
+    void Add(int entityID)
+    {
+        ids.push_back(entityID);
+        std::sort(ids.begin(), ids.end());
+    }
+
+    void Remove(int entityID)
+    {
+        auto it = std::find(ids.begin(), ids.end(), entityID);
+        if (it != ids.end()) ids.erase(it);
+    }
+};
+
+// Milliseconds per frame to destroy churn random entities out of population and spawn churn new ones,
+// each with a Mesh, Transform and Material, through the old per type index lists
+static double LegacyChurn(int population, int churn)
+{
+    LegacyIndex indices[3];
+    std::vector<int> alive;
+    std::vector<int> freeIDs;
+    for (int e = 0; e < population; e++)
+    {
+        alive.push_back(e);
+        for (LegacyIndex& index : indices) index.Add(e);
+    }
+
+    std::mt19937 random(1);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int frame = 0; frame < CHURN_FRAMES; frame++)
+    {
+        for (int i = 0; i < churn; i++)
+        {
+            int slot = (int)(random() % alive.size());
+            int e = alive[slot];
+            alive[slot] = alive.back();
+            alive.pop_back();
+            for (LegacyIndex& index : indices) index.Remove(e);
+            freeIDs.push_back(e);
+        }
+        for (int i = 0; i < churn; i++)
+        {
+            int e = freeIDs.back();
+            freeIDs.pop_back();
+            alive.push_back(e);
+            for (LegacyIndex& index : indices) index.Add(e);
+        }
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / CHURN_FRAMES;
+}
+
+// Same churn on an EntityManager. One entity and component at a time, or with the batch calls
+static double PoolChurn(int population, int churn, bool batched)
+{
+    EntityManager em;
+    Prefab prefab{ Mesh(), Transform(), Material() };
+    std::vector<Entity> alive = em.Instantiate(prefab, population);
+
+    std::mt19937 random(1);
+    std::vector<Entity> doomed;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int frame = 0; frame < CHURN_FRAMES; frame++)
+    {
+        doomed.clear();
+        for (int i = 0; i < churn; i++)
+        {
+            int slot = (int)(random() % alive.size());
+            doomed.push_back(alive[slot]);
+            alive[slot] = alive.back();
+            alive.pop_back();
+        }
+
+        if (batched)
+        {
+            em.DeregisterEntities(doomed);
+            std::vector<Entity> spawned = em.Instantiate(prefab, churn);
+            alive.insert(alive.end(), spawned.begin(), spawned.end());
+            continue;
+        }
+
+        for (Entity e : doomed) em.DeregisterEntity(e);
+        for (int i = 0; i < churn; i++)
+        {
+            Entity e = em.RegisterNewEntity();
+            em.AddComponent(e, Mesh());
+            em.AddComponent(e, Transform());
+            em.AddComponent(e, Material());
+            alive.push_back(e);
+        }
+    }
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / CHURN_FRAMES;
+
+    BENCHMARK_CHECK(em.GetEntityCount() == population);
+    BENCHMARK_CHECK(em.GetComponentPool<Transform>().Size() == population);
+    return milliseconds;
+}
+
+void RunChurnBenchmarks()
+{
+    // Destroy and respawn a share of the scene every frame. The old index lists are only measured
+    // at the smallest size, they already take over a second per frame there
+    struct Case { int population; int churn; bool legacy; };
+    const Case cases[] = { { 10000, 1000, true }, { 50000, 1000, false }, { 50000, 5000, false }, { 200000, 20000, false } };
+    for (const Case& c : cases)
+    {
+        double one = PoolChurn(c.population, c.churn, false);
+        double batch = PoolChurn(c.population, c.churn, true);
+        if (c.legacy)
+        {
+            double legacy = LegacyChurn(c.population, c.churn);
+            printf("  %6d alive, %5d churned per frame: legacy %9.3f ms, pools %7.3f ms, batched %7.3f ms per frame\n",
+                c.population, c.churn, legacy, one, batch);
+        }
+        else
+        {
+            printf("  %6d alive, %5d churned per frame: pools %7.3f ms, batched %7.3f ms per frame\n",
+                c.population, c.churn, one, batch);
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include "Benchmark.h"
+#include "EntityManager.h"
+#include "DrawOrder.h"
+#include <vector>
+#include <string>
+#include <tuple>
+
+using namespace ECS;
+
+#define DRAWABLES 20000
+#define DRAW_MESHES 40
+#define DRAW_TEXTURE_SETS 25
+#define DRAW_PIXEL_SHADERS 3
+#define DRAW_VERTEX_SHADERS 2
+
+// A drawable's mesh and material, spread over the choices so neighbours rarely share anything
+static Material MakeMaterial(int i)
+{
+    Material material;
+    int textures = (i * 7919) % DRAW_TEXTURE_SETS;
+    material.albedoName = "albedo" + std::to_string(textures);
+    material.normalsName = "normals" + std::to_string(textures);
+    material.metalnessName = "metal" + std::to_string(textures % 5);
+    material.roughnessName = "rough" + std::to_string(textures % 7);
+    material.aoName = "ao";
+    material.pixelShaderName = "PixelShader" + std::to_string((i * 31) % DRAW_PIXEL_SHADERS) + ".cso";
+    material.vertexShaderName = "VertexShader" + std::to_string((i * 17) % DRAW_VERTEX_SHADERS) + ".cso";
+    return material;
+}
+
+static void BuildDrawScene(EntityManager& em)
+{
+    std::vector<Entity> drawables = em.Instantiate(Prefab{ Mesh(), Transform(), Material() }, DRAWABLES);
+    for (int i = 0; i < (int)drawables.size(); i++)
+    {
+        em.GetComponent<Mesh>(drawables[i])->name = "mesh" + std::to_string((i * 104729) % DRAW_MESHES) + ".obj";
+        *em.GetComponent<Material>(drawables[i]) = MakeMaterial(i);
+    }
+}
+
+// Binds the renderer makes drawing the query in its current order, worked out from the names the
+// way it did before draw keys
+static int StateChangesByName(EntityManager& em)
+{
+    const Mesh* lastMesh = nullptr;
+    const Material* last = nullptr;
+    int changes = 0;
+    for (auto [e, mesh, transform, material] : em.GetCachedView<Mesh, Transform, Material>())
+    {
+        bool newPixelShader = last == nullptr || last->pixelShaderName != material.pixelShaderName;
+        if (newPixelShader) changes++;
+        if (newPixelShader || last->albedoName != material.albedoName || last->normalsName != material.normalsName
+            || last->metalnessName != material.metalnessName || last->roughnessName != material.roughnessName
+            || last->aoName != material.aoName) changes++;
+        if (last == nullptr || last->vertexShaderName != material.vertexShaderName) changes++;
+        if (lastMesh == nullptr || lastMesh->name != mesh.name) changes++;
+        last = &material;
+        lastMesh = &mesh;
+    }
+    return changes;
+}
+
+// The same, worked out from the keys the renderer compares now. Also checks the keys come in order
+static int StateChangesByKey(EntityManager& em, const DrawOrder& drawOrder, bool& sorted)
+{
+    uint64_t previous = DRAW_KEY_NONE;
+    int changes = 0;
+    sorted = true;
+    for (auto [e, mesh, transform, material] : em.GetCachedView<Mesh, Transform, Material>())
+    {
+        uint64_t key = drawOrder.KeyOf(e.Index());
+        if (previous != DRAW_KEY_NONE && key < previous) sorted = false;
+        changes += DrawOrder::StateChanges(previous, key);
+        previous = key;
+    }
+    return changes;
+}
+
+// The sort the renderer used before: string fields compared on every frame
+static auto NameOrder(const Mesh& mesh, const Transform&, const Material& material)
+{
+    return std::tie(material.pixelShaderName, material.vertexShaderName, material.albedoName, material.normalsName,
+        material.metalnessName, material.roughnessName, material.aoName, mesh.name);
+}
+
+// Milliseconds for what changing count materials costs the next frame's ordering, by both approaches
+static void MeasureChangedFrame(EntityManager& byName, EntityManager& byKey, DrawOrder& drawOrder, int count, int seed)
+{
+    auto change = [&](EntityManager& em) {
+        std::vector<Entity> entities = em.GetEntitiesWithComponents<Material>();
+        for (int i = 0; i < count; i++)
+        {
+            Entity entity = entities[(seed + i * 997) % entities.size()];
+            *em.GetComponentForWrite<Material>(entity) = MakeMaterial(seed + i);
+        }
+        em.AdvanceTick();
+    };
+
+    change(byName);
+    auto start = std::chrono::high_resolution_clock::now();
+    byName.SortCachedView<Mesh, Transform, Material>(&NameOrder);
+    double nameMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    change(byKey);
+    start = std::chrono::high_resolution_clock::now();
+    bool resorted = drawOrder.Update(byKey);
+    double keyMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    BENCHMARK_CHECK(resorted);
+
+    bool sorted = false;
+    int changes = StateChangesByKey(byKey, drawOrder, sorted);
+    BENCHMARK_CHECK(sorted);
+    BENCHMARK_CHECK(changes == StateChangesByName(byKey));
+    printf("  %4d materials changed: string sort %7.3f ms, key update and sort %7.3f ms\n", count, nameMilliseconds, keyMilliseconds);
+}
+
+void RunDrawOrderBenchmarks()
+{
+    EntityManager byName;
+    EntityManager byKey;
+    BuildDrawScene(byName);
+    BuildDrawScene(byKey);
+
+    int unsortedChanges = StateChangesByName(byKey);
+    DrawOrder drawOrder;
+    double firstUpdate = BestMilliseconds(1, [&]() { drawOrder.Update(byKey); });
+    bool sorted = false;
+    int sortedChanges = StateChangesByKey(byKey, drawOrder, sorted);
+    BENCHMARK_CHECK(sorted);
+    // The ids stand in for the names exactly, so the counts agree
+    BENCHMARK_CHECK(sortedChanges == StateChangesByName(byKey));
+    printf("  %d drawables, %d meshes, %d texture sets, %d + %d shaders: %d state changes unsorted, %d sorted (%.1fx fewer)\n",
+        DRAWABLES, DRAW_MESHES, DRAW_TEXTURE_SETS, DRAW_PIXEL_SHADERS, DRAW_VERTEX_SHADERS,
+        unsortedChanges, sortedChanges, (double)unsortedChanges / sortedChanges);
+    printf("  first key update and sort %.3f ms\n", firstUpdate);
+
+    // Frames where nothing a draw binds has changed
+    byName.SortCachedView<Mesh, Transform, Material>(&NameOrder);
+    double nameIdle = BestMilliseconds(BENCHMARK_RUNS, [&]() { byName.SortCachedView<Mesh, Transform, Material>(&NameOrder); });
+    bool resorted = false;
+    double keyIdle = BestMilliseconds(BENCHMARK_RUNS, [&]() { byKey.AdvanceTick(); resorted |= drawOrder.Update(byKey); });
+    BENCHMARK_CHECK(!resorted);
+    printf("  nothing changed: string sort check %7.3f ms, key update %7.4f ms per frame\n", nameIdle, keyIdle);
+
+    MeasureChangedFrame(byName, byKey, drawOrder, 10, 1);
+    MeasureChangedFrame(byName, byKey, drawOrder, 1000, 2);
+}
\ No newline at end of file
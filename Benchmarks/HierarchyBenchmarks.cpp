@@ -0,0 +1,166 @@
+#include "Benchmark.h"
+#include "EntityManager.h"
+#include "JobSystem.h"
+#include "TransformSystem.h"
+#include <vector>
+#include <cstring>
+#include <climits>
+#include <cmath>
+
+using namespace ECS;
+using namespace DirectX;
+
+#define HIERARCHY_FRAMES 10
+
+// Fastest update of each kind of frame for one hierarchy, in milliseconds
+struct HierarchyTimes
+{
+    // The first update, building the hierarchy and every matrix
+    double build;
+    // Every root moved, so every node is propagated
+    double allRootsMoved;
+    // One root moved, so only its subtree is
+    double oneRootMoved;
+    double nothingMoved;
+};
+
+// count chains of depth entities each, every child one unit above its parent. Returns the roots
+static std::vector<Entity> BuildChains(EntityManager& em, int count, int depth)
+{
+    std::vector<Entity> roots = em.Instantiate(Prefab{ Transform() }, count);
+    std::vector<Entity> tips = roots;
+    for (int level = 1; level < depth; level++)
+    {
+        Transform local;
+        TransformSystem::SetPosition(&local, 0, 1, 0);
+        std::vector<Entity> children = em.Instantiate(Prefab{ local, Parent() }, count);
+        for (int i = 0; i < count; i++) em.GetComponent<Parent>(children[i])->entity = tips[i];
+        tips = children;
+    }
+    return roots;
+}
+
+// count roots with width children each, all on one level. Returns the roots
+static std::vector<Entity> BuildFans(EntityManager& em, int count, int width)
+{
+    std::vector<Entity> roots = em.Instantiate(Prefab{ Transform() }, count);
+    for (int i = 0; i < count; i++)
+    {
+        Transform local;
+        TransformSystem::SetPosition(&local, 0, 1, 0);
+        std::vector<Entity> children = em.Instantiate(Prefab{ local, Parent() }, width);
+        for (Entity child : children) em.GetComponent<Parent>(child)->entity = roots[i];
+    }
+    return roots;
+}
+
+// Times the kinds of frame on the hierarchy build makes, with threshold as the transform system's
+// parallel threshold. Fills worldMatrices with every transform's world matrix at the end, in pool order
+template <class Build>
+static HierarchyTimes MeasureHierarchy(Build build, int threshold, std::vector<XMFLOAT4X4>& worldMatrices)
+{
+    EntityManager em;
+    std::vector<Entity> roots = build(em);
+    TransformSystem transformSystem(em);
+    transformSystem.SetParallelThreshold(threshold);
+
+    auto timeUpdate = [&]() {
+        auto start = std::chrono::high_resolution_clock::now();
+        transformSystem.Update(em, 1.0f / 60.0f);
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    };
+
+    HierarchyTimes times;
+    times.build = timeUpdate();
+    times.allRootsMoved = 1e30;
+    times.oneRootMoved = 1e30;
+    times.nothingMoved = 1e30;
+    for (int frame = 1; frame <= HIERARCHY_FRAMES; frame++)
+    {
+        em.AdvanceTick();
+        for (int i = 0; i < (int)roots.size(); i++)
+        {
+            Transform* t = em.GetComponentForWrite<Transform>(roots[i]);
+            TransformSystem::SetPosition(t, (float)i, 0, (float)frame);
+            TransformSystem::SetPitchYawRoll(t, 0, 0.1f * frame, 0);
+        }
+        times.allRootsMoved = (std::min)(times.allRootsMoved, timeUpdate());
+
+        em.AdvanceTick();
+        Transform* t = em.GetComponentForWrite<Transform>(roots[frame % roots.size()]);
+        TransformSystem::MoveAbsolute(t, 0, 0.5f, 0);
+        times.oneRootMoved = (std::min)(times.oneRootMoved, timeUpdate());
+
+        em.AdvanceTick();
+        times.nothingMoved = (std::min)(times.nothingMoved, timeUpdate());
+    }
+
+    worldMatrices.clear();
+    em.ForEach<Transform>([&](Entity, Transform& t) { worldMatrices.push_back(t.worldMatrix); });
+    return times;
+}
+
+// Runs one hierarchy shape down the serial path and the parallel one and prints both
+template <class Build>
+static void RunHierarchy(const char* shape, Build build, float expectedTopY)
+{
+    std::vector<XMFLOAT4X4> serialMatrices;
+    std::vector<XMFLOAT4X4> parallelMatrices;
+    HierarchyTimes serial = MeasureHierarchy(build, INT_MAX, serialMatrices);
+    HierarchyTimes parallel = MeasureHierarchy(build, TRANSFORM_PARALLEL_THRESHOLD, parallelMatrices);
+    BENCHMARK_CHECK(parallelMatrices.size() == serialMatrices.size()
+        && std::memcmp(parallelMatrices.data(), serialMatrices.data(), serialMatrices.size() * sizeof(XMFLOAT4X4)) == 0);
+
+    // The last entity made is at the top of its chain or fan, and sits where its ancestors put it
+    float topY = serialMatrices.back()._42;
+    BENCHMARK_CHECK(std::fabs(topY - expectedTopY) < 1e-3f);
+
+    printf("  %s, %d transforms\n", shape, (int)serialMatrices.size());
+    printf("    serial:   build %8.3f ms, all roots moved %8.3f ms, one root moved %7.3f ms, nothing moved %7.3f ms\n",
+        serial.build, serial.allRootsMoved, serial.oneRootMoved, serial.nothingMoved);
+    printf("    parallel: build %8.3f ms, all roots moved %8.3f ms, one root moved %7.3f ms, nothing moved %7.3f ms\n",
+        parallel.build, parallel.allRootsMoved, parallel.oneRootMoved, parallel.nothingMoved);
+}
+
+// A two level hierarchy built in its own EntityManager and merged into one that already has entities,
+// so every slot changes. Each Parent has to follow its parent to the new slot, and one whose parent
+// was destroyed before the merge must not pick up whoever reused or moved into that slot
+static void CheckMergedHierarchy()
+{
+    EntityManager staging;
+    Transform local;
+    TransformSystem::SetPosition(&local, 0, 1, 0);
+    Entity root = staging.Instantiate(Prefab{ local }, 1)[0];
+    Entity child = staging.Instantiate(Prefab{ local, Parent{ root } }, 1)[0];
+    Entity grandchild = staging.Instantiate(Prefab{ local, Parent{ child } }, 1)[0];
+    Entity gone = staging.Instantiate(Prefab{ local }, 1)[0];
+    Entity orphan = staging.Instantiate(Prefab{ local, Parent{ gone } }, 1)[0];
+    staging.DeregisterEntities({ gone });
+
+    EntityManager live;
+    live.Instantiate(Prefab{ Transform() }, 7);
+    std::vector<Entity> moved = staging.MergeInto(live);
+    TransformSystem transformSystem(live);
+    transformSystem.Update(live, 0);
+
+    BENCHMARK_CHECK(live.GetComponent<Parent>(moved[child.Index()])->entity == moved[root.Index()]);
+    BENCHMARK_CHECK(live.GetComponent<Parent>(moved[grandchild.Index()])->entity == moved[child.Index()]);
+    BENCHMARK_CHECK(live.GetComponent<Parent>(moved[orphan.Index()])->entity == INVALID_ENTITY);
+    BENCHMARK_CHECK(std::fabs(live.GetComponent<Transform>(moved[grandchild.Index()])->worldMatrix._42 - 3.0f) < 1e-3f);
+    BENCHMARK_CHECK(std::fabs(live.GetComponent<Transform>(moved[orphan.Index()])->worldMatrix._42 - 1.0f) < 1e-3f);
+}
+
+void RunHierarchyBenchmarks()
+{
+    delete &JobSystem::GetInstance();
+    JobSystem& jobSystem = JobSystem::Initialize(3);
+    printf("  %d workers\n", jobSystem.GetWorkerCount());
+
+    // Every root ends up at y 0 apart from the few moved alone, which never include the last one, so
+    // the last entity made sits a unit above its parent times its depth
+    RunHierarchy("deep: 1000 chains, 100 deep", [](EntityManager& em) { return BuildChains(em, 1000, 100); }, 99.0f);
+    RunHierarchy("wide: 100 roots, 1000 children each", [](EntityManager& em) { return BuildFans(em, 100, 1000); }, 1.0f);
+    CheckMergedHierarchy();
+
+    delete &JobSystem::GetInstance();
+}
\ No newline at end of file
@@ -0,0 +1,132 @@
+#include "Benchmark.h"
+#include "EntityManager.h"
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <iterator>
+
+using namespace ECS;
+
+// The layout the pools replaced: one heap object per component behind a pointer, recognised by a
+// virtual ID() and fetched with a dynamic_cast, and a sorted list of entity ids per type to intersect
+struct LegacyComponent
+{
+    virtual int ID() { return INVALID_COMPONENT; }
+    virtual ~LegacyComponent() {}
+};
+
+struct LegacyMesh : LegacyComponent
+{
+    Mesh data;
+    int ID() override { return ComponentID<Mesh>; }
+};
+
+struct LegacyTransform : LegacyComponent
+{
+    Transform data;
+    int ID() override { return ComponentID<Transform>; }
+};
+
+struct LegacyWorld
+{
+    // Accessed like components[componentID][entityID]
+    std::vector<std::vector<std::unique_ptr<LegacyComponent>>> components;
+    std::vector<std::vector<int>> componentEntityIDs;
+
+    LegacyWorld(int entityCount) : components(NUM_COMPONENT_TYPES), componentEntityIDs(NUM_COMPONENT_TYPES)
+    {
+        // Every slot started out with a placeholder, real components replaced them one entity at a time
+        for (auto& slots : components)
+        {
+            slots.resize(entityCount);
+            for (auto& slot : slots) slot = std::make_unique<LegacyComponent>();
+        }
+        for (int e = 0; e < entityCount; e++)
+        {
+            auto mesh = std::make_unique<LegacyMesh>();
+            mesh->data.indices = e & 7;
+            auto transform = std::make_unique<LegacyTransform>();
+            transform->data.worldMatrix._41 = (float)e;
+            components[ComponentID<Mesh>][e] = std::move(mesh);
+            components[ComponentID<Transform>][e] = std::move(transform);
+            componentEntityIDs[ComponentID<Mesh>].push_back(e);
+            componentEntityIDs[ComponentID<Transform>].push_back(e);
+        }
+    }
+
+    template <class Legacy>
+    Legacy* Get(int componentID, int entityID)
+    {
+        return dynamic_cast<Legacy*>(components[componentID][entityID].get());
+    }
+
+    // GetEntitiesWithComponents<Mesh, Transform> as it was: a fresh vector from an intersection
+    std::vector<int> MeshesWithTransforms()
+    {
+        std::vector<int> intersection;
+        const auto& meshes = componentEntityIDs[ComponentID<Mesh>];
+        const auto& transforms = componentEntityIDs[ComponentID<Transform>];
+        std::set_intersection(meshes.begin(), meshes.end(), transforms.begin(), transforms.end(), std::back_inserter(intersection));
+        return intersection;
+    }
+};
+
+// What a system like the renderer reads from each entity
+static float Visit(const Mesh& mesh, const Transform& transform)
+{
+    return transform.worldMatrix._41 + (float)mesh.indices;
+}
+
+static void MeasureIteration(int entityCount)
+{
+    double legacyMilliseconds;
+    {
+        LegacyWorld legacy(entityCount);
+        legacyMilliseconds = BestMilliseconds(BENCHMARK_RUNS, [&]() {
+            float sum = 0;
+            for (int e : legacy.MeshesWithTransforms())
+            {
+                LegacyMesh* mesh = legacy.Get<LegacyMesh>(ComponentID<Mesh>, e);
+                LegacyTransform* transform = legacy.Get<LegacyTransform>(ComponentID<Transform>, e);
+                sum += Visit(mesh->data, transform->data);
+            }
+            benchmarkSink = sum;
+        });
+    }
+
+    EntityManager em;
+    Prefab prefab{ Mesh(), Transform() };
+    std::vector<Entity> entities = em.Instantiate(prefab, entityCount);
+    for (int i = 0; i < (int)entities.size(); i++)
+    {
+        em.GetComponent<Mesh>(entities[i])->indices = i & 7;
+        em.GetComponent<Transform>(entities[i])->worldMatrix._41 = (float)i;
+    }
+
+    double viewMilliseconds = BestMilliseconds(BENCHMARK_RUNS, [&]() {
+        float sum = 0;
+        for (auto [e, mesh, transform] : em.GetView<Mesh, Transform>()) sum += Visit(mesh, transform);
+        benchmarkSink = sum;
+    });
+    double cachedMilliseconds = BestMilliseconds(BENCHMARK_RUNS, [&]() {
+        float sum = 0;
+        for (auto [e, mesh, transform] : em.GetCachedView<Mesh, Transform>()) sum += Visit(mesh, transform);
+        benchmarkSink = sum;
+    });
+    double poolMilliseconds = BestMilliseconds(BENCHMARK_RUNS, [&]() {
+        float sum = 0;
+        em.GetComponentPool<Transform>().ForEach([&](int, Transform& transform) { sum += transform.worldMatrix._41; });
+        benchmarkSink = sum;
+    });
+
+    printf("  %7d entities: legacy %8.3f ms, view %8.3f ms, cached view %8.3f ms, one pool %8.3f ms (%.1fx legacy/view)\n",
+        entityCount, legacyMilliseconds, viewMilliseconds, cachedMilliseconds, poolMilliseconds, legacyMilliseconds / viewMilliseconds);
+}
+
+void RunIterationBenchmarks()
+{
+    // Mesh + Transform entities visited the way a system reads them, old pointer layout against pools
+    MeasureIteration(4096);
+    MeasureIteration(64 * 1024);
+    MeasureIteration(1000000);
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include "Benchmark.h"
+#include "JobSystem.h"
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <cmath>
+
+#define SPAWNED_JOBS 100000
+#define SCALING_JOBS 256
+
+// Some arithmetic that takes a while and can't be skipped
+static float Work(int seed, int iterations)
+{
+    float x = (float)seed;
+    for (int i = 0; i < iterations; i++) x = std::sqrt(x * x + 1.0f);
+    return x;
+}
+
+// Nanoseconds per job to submit empty jobs from the main thread and wait for them
+static double MeasureSpawn(JobSystem& jobSystem)
+{
+    double milliseconds = BestMilliseconds(BENCHMARK_RUNS, [&]() {
+        JobCounter counter;
+        for (int i = 0; i < SPAWNED_JOBS; i++) jobSystem.Run([]() {}, &counter);
+        jobSystem.Wait(counter);
+    });
+    return milliseconds * 1e6 / SPAWNED_JOBS;
+}
+
+// Nanoseconds per job for the other workers to steal small jobs off the main thread's queue
+// while it only watches
+static double MeasureSteal(JobSystem& jobSystem)
+{
+    std::vector<float> results(JOB_QUEUE_CAPACITY / 2);
+    float* out = results.data();
+    double milliseconds = BestMilliseconds(BENCHMARK_RUNS, [&]() {
+        JobCounter counter;
+        for (int i = 0; i < (int)results.size(); i++) jobSystem.Run([out, i]() { out[i] = Work(i, 16); }, &counter);
+        while (!counter.Done()) std::this_thread::yield();
+    });
+    benchmarkSink = results.back();
+    return milliseconds * 1e6 / (JOB_QUEUE_CAPACITY / 2);
+}
+
+// Milliseconds for the same fixed amount of work split into jobs
+static double MeasureScaling(JobSystem& jobSystem)
+{
+    float results[SCALING_JOBS];
+    double milliseconds = BestMilliseconds(BENCHMARK_RUNS, [&]() {
+        JobCounter counter;
+        for (int i = 0; i < SCALING_JOBS; i++) jobSystem.Run([&results, i]() { results[i] = Work(i, 20000); }, &counter);
+        jobSystem.Wait(counter);
+    });
+    benchmarkSink = results[SCALING_JOBS - 1];
+    return milliseconds;
+}
+
+// Continuations only run once everything they depend on has, and chains of them run in order
+static void CheckContinuations(JobSystem& jobSystem)
+{
+    std::atomic<int> finished{ 0 };
+    std::atomic<int> seenByContinuation{ -1 };
+    JobCounter first;
+    JobCounter second;
+    for (int i = 0; i < 64; i++) jobSystem.Run([&finished, i]() { if (Work(i, 1000) > 0) finished++; }, &first);
+    jobSystem.RunAfter(first, [&]() { seenByContinuation = finished.load(); }, &second);
+
+    // A chain of continuations, each queued behind the one before
+    const int chainLength = 1000;
+    std::vector<JobCounter> links(chainLength);
+    std::atomic<int> next{ 0 };
+    std::atomic<bool> ordered{ true };
+    jobSystem.RunAfter(second, [&]() { if (next++ != 0) ordered = false; }, &links[0]);
+    for (int i = 1; i < chainLength; i++)
+    {
+        jobSystem.RunAfter(links[i - 1], [&, i]() { if (next++ != i) ordered = false; }, &links[i]);
+    }
+
+    jobSystem.Wait(links[chainLength - 1]);
+    BENCHMARK_CHECK(seenByContinuation == 64);
+    BENCHMARK_CHECK(next == chainLength);
+    BENCHMARK_CHECK(ordered);
+}
+
+void RunJobBenchmarks()
+{
+    int cores = (std::max)(1, (int)std::thread::hardware_concurrency());
+    int maxWorkers = (std::max)(cores, 4);
+    double oneWorker = 0;
+    for (int workers = 1; workers <= maxWorkers; workers *= 2)
+    {
+        // Start over with a job system of this size
+        delete &JobSystem::GetInstance();
+        JobSystem& jobSystem = JobSystem::Initialize(workers - 1);
+
+        CheckContinuations(jobSystem);
+        double spawn = MeasureSpawn(jobSystem);
+        double scaling = MeasureScaling(jobSystem);
+        if (workers == 1) oneWorker = scaling;
+        if (workers > 1)
+        {
+            double steal = MeasureSteal(jobSystem);
+            printf("  %2d workers: spawn %6.1f ns per job, steal %6.1f ns per job, %d jobs of work %8.3f ms (%.2fx)\n",
+                workers, spawn, steal, SCALING_JOBS, scaling, oneWorker / scaling);
+        }
+        else
+        {
+            printf("  %2d workers: spawn %6.1f ns per job, %d jobs of work %8.3f ms\n", workers, spawn, SCALING_JOBS, scaling);
+        }
+    }
+    printf("  (%d hardware threads)\n", cores);
+
+    // Back to the default size for whatever runs next
+    delete &JobSystem::GetInstance();
+}
\ No newline at end of file
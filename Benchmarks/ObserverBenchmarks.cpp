@@ -0,0 +1,63 @@
+#include "Benchmark.h"
+#include "EntityManager.h"
+#include <vector>
+
+using namespace ECS;
+
+#define OBSERVED_ENTITIES 100000
+
+// Observers registering more observers for the same component from inside a flush. Enough are added
+// that the list has to grow, and the new ones only start getting called on the next flush
+static void CheckObserversRegisteredDuringFlush()
+{
+    EntityManager em;
+    int firstCalls = 0;
+    int laterCalls = 0;
+    int laterEntities = 0;
+    em.OnAdd<Transform>([&](const std::vector<Entity>&) {
+        firstCalls++;
+        for (int i = 0; i < 64; i++)
+        {
+            em.OnAdd<Transform>([&](const std::vector<Entity>& laterAdded) {
+                laterCalls++;
+                laterEntities += (int)laterAdded.size();
+            });
+        }
+    });
+
+    em.Instantiate(Prefab{ Transform() }, 10);
+    em.FlushCommands();
+    BENCHMARK_CHECK(firstCalls == 1);
+    BENCHMARK_CHECK(laterCalls == 0);
+
+    em.Instantiate(Prefab{ Transform() }, 5);
+    em.FlushCommands();
+    BENCHMARK_CHECK(firstCalls == 2);
+    BENCHMARK_CHECK(laterCalls == 64);
+    BENCHMARK_CHECK(laterEntities == 64 * 5);
+}
+
+void RunObserverBenchmarks()
+{
+    CheckObserversRegisteredDuringFlush();
+
+    // What a flush costs to hand a big batch of added or changed entities to an observer
+    EntityManager em;
+    int64_t seen = 0;
+    em.OnAdd<Transform>([&](const std::vector<Entity>& added) { seen += (int64_t)added.size(); });
+    em.OnChange<Transform>([&](const std::vector<Entity>& changed) { seen += (int64_t)changed.size(); });
+
+    std::vector<Entity> entities = em.Instantiate(Prefab{ Transform() }, OBSERVED_ENTITIES);
+    double addFlush = BestMilliseconds(1, [&]() { em.FlushCommands(); });
+    BENCHMARK_CHECK(seen == OBSERVED_ENTITIES);
+
+    seen = 0;
+    double changeFlush = BestMilliseconds(BENCHMARK_RUNS, [&]() {
+        em.AdvanceTick();
+        for (Entity entity : entities) em.MarkChanged<Transform>(entity);
+        em.FlushCommands();
+    });
+    BENCHMARK_CHECK(seen == (int64_t)OBSERVED_ENTITIES * BENCHMARK_RUNS);
+    printf("  %d entities: flush reporting them added %.3f ms, marking them changed and flushing %.3f ms\n",
+        OBSERVED_ENTITIES, addFlush, changeFlush);
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include "Benchmark.h"
+#include "EntityManager.h"
+#include "JobSystem.h"
+#include "TransformSystem.h"
+#include "Raycasting.h"
+#include <vector>
+
+using namespace ECS;
+
+#define RAYCAST_TARGETS 100000
+
+// A camera looking down -z at a grid of raycastable boxes, with one box right in front of it
+static Entity BuildRaycastScene(EntityManager& em)
+{
+    Mesh box;
+    box.boundingMin = { -0.5f, -0.5f, -0.5f };
+    box.boundingMax = { 0.5f, 0.5f, 0.5f };
+    std::vector<Entity> targets = em.Instantiate(Prefab{ box, Transform(), Material(), RaycastObject() }, RAYCAST_TARGETS);
+    for (int i = 0; i < (int)targets.size(); i++)
+    {
+        Transform* t = em.GetComponent<Transform>(targets[i]);
+        TransformSystem::SetPosition(t, (float)(i % 300) * 2.0f - 300.0f, (float)((i / 300) % 300) * 2.0f - 300.0f, -10.0f - (float)(i / 90000) * 5.0f);
+        TransformSystem::UpdateMatrices(t);
+    }
+
+    // The nearest box, so the expected hit is known
+    Transform* nearest = em.GetComponent<Transform>(targets.back());
+    TransformSystem::SetPosition(nearest, 0, 0, -3);
+    TransformSystem::UpdateMatrices(nearest);
+
+    // An unrotated camera at the origin, the view is right handed so it looks down -z
+    Transform camera;
+    TransformSystem::UpdateMatrices(&camera);
+    em.Instantiate(Prefab{ Camera(), camera }, 1);
+    return targets.back();
+}
+
+void RunParallelForBenchmarks()
+{
+    EntityManager em;
+    Entity nearest = BuildRaycastScene(em);
+    Raycasting raycasting;
+
+    // The same view walked serially with ForEach for reference
+    double serial = BestMilliseconds(BENCHMARK_RUNS, [&]() {
+        float sum = 0;
+        em.ForEach<Transform>([&](Entity, Transform& t) { sum += t.worldInverseMatrix._41 * t.worldInverseMatrix._42; });
+        benchmarkSink = sum;
+    });
+    printf("  ForEach over %d transforms, one thread: %.3f ms\n", RAYCAST_TARGETS, serial);
+
+    // Raycasting's dynamic pass and a write to every transform through ParallelForEach, at each size of job system
+    double oneWorkerRaycast = 0;
+    double oneWorkerWrite = 0;
+    for (int workers = 1; workers <= 16; workers *= 2)
+    {
+        delete &JobSystem::GetInstance();
+        JobSystem::Initialize(workers - 1);
+
+        double raycast = BestMilliseconds(BENCHMARK_RUNS, [&]() { raycasting.Update(em, 0); });
+        BENCHMARK_CHECK(Raycasting::hitEntity == nearest);
+
+        double write = BestMilliseconds(BENCHMARK_RUNS, [&]() {
+            em.ParallelForEach<Transform>([](Entity, Transform& t) { t.up.x = t.worldInverseMatrix._41 * t.worldInverseMatrix._42; });
+        });
+        if (workers == 1)
+        {
+            oneWorkerRaycast = raycast;
+            oneWorkerWrite = write;
+        }
+        printf("  %2d workers: raycast over %d boxes %7.3f ms (%.2fx), ParallelForEach write %7.3f ms (%.2fx)\n",
+            workers, RAYCAST_TARGETS, raycast, oneWorkerRaycast / raycast, write, oneWorkerWrite / write);
+    }
+    printf("  (%d hardware threads)\n", (int)std::thread::hardware_concurrency());
+
+    delete &JobSystem::GetInstance();
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include "Benchmark.h"
+#include "EntityManager.h"
+#include <vector>
+#include <string>
+
+using namespace ECS;
+
+// What each system reads from a match, 1 for the identity world matrix every entity starts with
+static int Visit(const Transform& transform)
+{
+    return transform.worldMatrix._44 == 1.0f ? 1 : 0;
+}
+
+// Milliseconds for one frame of queries(). Each run is timed on its own so the compiler can't merge
+// the queries of several frames
+template <class Queries>
+static double MeasureFrame(Queries queries)
+{
+    return BestMilliseconds(4 * BENCHMARK_RUNS, [&]() { benchmarkSink = (float)queries(); });
+}
+
+// The three queries the systems make every frame, drawables, the camera and raycast targets, run through
+// each API on em reading every match's transform. Prints the per frame cost.
+// expected is how many entities the three queries match between them
+static void MeasureQueries(const char* scene, EntityManager& em, int expected)
+{
+    double entitiesMilliseconds = MeasureFrame([&]() {
+        int matches = 0;
+        for (Entity e : em.GetEntitiesWithComponents<Mesh, Transform, Material>()) matches += Visit(*em.GetComponent<Transform>(e));
+        for (Entity e : em.GetEntitiesWithComponents<Camera, Transform>()) matches += Visit(*em.GetComponent<Transform>(e));
+        for (Entity e : em.GetEntitiesWithComponents<Mesh, Transform, Material, RaycastObject>()) matches += Visit(*em.GetComponent<Transform>(e));
+        return matches;
+    });
+    BENCHMARK_CHECK(benchmarkSink == (float)expected);
+    double viewMilliseconds = MeasureFrame([&]() {
+        int matches = 0;
+        for (auto [e, mesh, transform, material] : em.GetView<Mesh, Transform, Material>()) matches += Visit(transform);
+        for (auto [e, camera, transform] : em.GetView<Camera, Transform>()) matches += Visit(transform);
+        for (auto [e, mesh, transform, material, raycast] : em.GetView<Mesh, Transform, Material, RaycastObject>()) matches += Visit(transform);
+        return matches;
+    });
+    BENCHMARK_CHECK(benchmarkSink == (float)expected);
+    double cachedMilliseconds = MeasureFrame([&]() {
+        int matches = 0;
+        for (auto [e, mesh, transform, material] : em.GetCachedView<Mesh, Transform, Material>()) matches += Visit(transform);
+        for (auto [e, camera, transform] : em.GetCachedView<Camera, Transform>()) matches += Visit(transform);
+        for (auto [e, mesh, transform, material, raycast] : em.GetCachedView<Mesh, Transform, Material, RaycastObject>()) matches += Visit(transform);
+        return matches;
+    });
+    BENCHMARK_CHECK(benchmarkSink == (float)expected);
+
+    printf("  %s: GetEntitiesWithComponents %.3f ms, view %.3f ms, cached view %.3f ms per frame\n",
+        scene, entitiesMilliseconds, viewMilliseconds, cachedMilliseconds);
+}
+
+// Raycast targets coming and going every tick after the cached queries were filled, and what keeping
+// the queries up to date costs according to GetStats
+static void MeasureQueryUpkeep(EntityManager& em, std::vector<Entity>& drawables)
+{
+    const int toggledPerTick = 1000;
+    const int ticks = 20;
+    for (int tick = 0; tick < ticks; tick++)
+    {
+        for (int i = 0; i < toggledPerTick; i++)
+        {
+            Entity entity = drawables[(tick * toggledPerTick + i) % drawables.size()];
+            if (em.HasComponent<RaycastObject>(entity)) em.RemoveComponent<RaycastObject>(entity);
+            else em.AddComponent(entity, RaycastObject());
+        }
+        em.AdvanceTick();
+    }
+
+    EntityManagerStats stats = em.GetStats();
+    double lastTick = 0;
+    double total = 0;
+    for (const QueryStats& query : stats.queries)
+    {
+        if (!(query.required & SignatureOf<RaycastObject>)) continue;
+        lastTick += query.lastTickUpdateMilliseconds;
+        total += query.updateMilliseconds;
+    }
+    BENCHMARK_CHECK(lastTick > 0);
+    BENCHMARK_CHECK(total >= lastTick);
+    printf("  cached raycast query upkeep, %d targets added or removed per tick: %.4f ms last tick, %.3f ms over %d ticks\n",
+        toggledPerTick, lastTick, total, ticks);
+
+    // Pools are named the same on every compiler
+    std::string json = stats.ToJson();
+    BENCHMARK_CHECK(json.find("{\"name\":\"Transform\",") != std::string::npos);
+}
+
+void RunQueryBenchmarks()
+{
+    // 50k entities: 40k drawables, 5k of them raycastable, 10k transforms with nothing else and a camera.
+    // Views already walk the smallest pool here, and every entity in it matches
+    {
+        EntityManager em;
+        std::vector<Entity> drawables = em.Instantiate(Prefab{ Mesh(), Transform(), Material() }, 40000);
+        for (int i = 0; i < 5000; i++) em.AddComponent(drawables[i * 8], RaycastObject());
+        em.Instantiate(Prefab{ Transform() }, 10000);
+        em.Instantiate(Prefab{ Camera(), Transform() }, 1);
+        MeasureQueries("50k drawables scene", em, 40000 + 1 + 5000);
+        MeasureQueryUpkeep(em, drawables);
+    }
+
+    // 50k entities where most meshes and materials sit on entities missing another component, and most
+    // raycast targets aren't drawn, so even the smallest pool is mostly entities a view has to reject
+    {
+        EntityManager em;
+        std::vector<Entity> drawables = em.Instantiate(Prefab{ Mesh(), Transform(), Material() }, 5000);
+        for (int i = 0; i < 1000; i++) em.AddComponent(drawables[i * 5], RaycastObject());
+        em.Instantiate(Prefab{ Mesh(), Transform() }, 20000);
+        em.Instantiate(Prefab{ Transform(), Material() }, 15000);
+        em.Instantiate(Prefab{ Transform(), RaycastObject() }, 10000);
+        em.Instantiate(Prefab{ Camera(), Transform() }, 1);
+        MeasureQueries("50k mixed scene    ", em, 5000 + 1 + 1000);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+#include "Benchmark.h"
+#include "EntityManager.h"
+#include "JobSystem.h"
+#include <vector>
+#include <algorithm>
+#include <thread>
+
+using namespace ECS;
+
+#define SPAWN_JOBS 64
+#define SPAWNS_PER_JOB 512
+#define SPAWN_ROUNDS 20
+
+// Jobs reserving entities and staging their components at once, then one flush making them real.
+// Half the world is freed first so reservations come from both the free list and untouched slots.
+// Returns milliseconds for the reserving jobs and the flush together
+static double SpawnRound(EntityManager& em, JobSystem& jobSystem, int round)
+{
+    // Free every other entity so the free list has slots to hand out
+    std::vector<Entity> existing;
+    em.ForEach<Transform>([&](Entity entity, Transform&) { existing.push_back(entity); });
+    std::vector<Entity> freed;
+    for (int i = round % 2; i < (int)existing.size(); i += 2) freed.push_back(existing[i]);
+    em.DeregisterEntities(freed);
+    int countBefore = em.GetEntityCount();
+
+    std::vector<Entity> reserved(SPAWN_JOBS * SPAWNS_PER_JOB);
+    Entity* out = reserved.data();
+    EntityManager* world = &em;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    JobCounter counter;
+    for (int job = 0; job < SPAWN_JOBS; job++)
+    {
+        jobSystem.Run([world, out, job]() {
+            CommandBuffer& commands = world->GetCommandBuffer();
+            for (int i = 0; i < SPAWNS_PER_JOB; i++)
+            {
+                Entity entity = world->ReserveEntity();
+                out[job * SPAWNS_PER_JOB + i] = entity;
+                Transform transform;
+                transform.position.x = (float)(job * SPAWNS_PER_JOB + i);
+                commands.AddComponent(entity, transform);
+            }
+        }, &counter);
+    }
+    jobSystem.Wait(counter);
+
+    // Nothing reserved is alive yet, not even handles to reused slots whose generation already matches
+    int aliveEarly = 0;
+    for (Entity entity : reserved) aliveEarly += em.IsAlive(entity);
+    BENCHMARK_CHECK(aliveEarly == 0);
+
+    em.FlushCommands();
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    // Every reservation got its own slot, went live, and kept the component staged for it
+    std::vector<Entity> sorted = reserved;
+    std::sort(sorted.begin(), sorted.end(), [](Entity a, Entity b) { return a.Index() < b.Index(); });
+    bool unique = std::adjacent_find(sorted.begin(), sorted.end(), [](Entity a, Entity b) { return a.Index() == b.Index(); }) == sorted.end();
+    BENCHMARK_CHECK(unique);
+    int wrong = 0;
+    for (int i = 0; i < (int)reserved.size(); i++)
+    {
+        Transform* t = em.GetComponent<Transform>(reserved[i]);
+        if (t == nullptr || t->position.x != (float)i) wrong++;
+    }
+    BENCHMARK_CHECK(wrong == 0);
+    BENCHMARK_CHECK(em.GetEntityCount() == countBefore + SPAWN_JOBS * SPAWNS_PER_JOB);
+
+    // Stale handles to the freed slots stay dead after they're reused
+    int staleAlive = 0;
+    for (Entity entity : freed) staleAlive += em.IsAlive(entity);
+    BENCHMARK_CHECK(staleAlive == 0);
+    return milliseconds;
+}
+
+void RunSpawnBenchmarks()
+{
+    int cores = (std::max)(1, (int)std::thread::hardware_concurrency());
+    int maxWorkers = (std::max)(cores, 4);
+    for (int workers = 1; workers <= maxWorkers; workers *= 2)
+    {
+        delete &JobSystem::GetInstance();
+        JobSystem& jobSystem = JobSystem::Initialize(workers - 1);
+
+        EntityManager em;
+        double best = 1e30;
+        for (int round = 0; round < SPAWN_ROUNDS; round++) best = (std::min)(best, SpawnRound(em, jobSystem, round));
+        printf("  %2d workers: %d jobs reserving %d entities each and one flush, %7.3f ms (%.1f ns per entity)\n",
+            workers, SPAWN_JOBS, SPAWNS_PER_JOB, best, best * 1e6 / (SPAWN_JOBS * SPAWNS_PER_JOB));
+    }
+    printf("  (%d hardware threads)\n", cores);
+
+    delete &JobSystem::GetInstance();
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include "Benchmark.h"
+#include "TransformBatch.h"
+
+#define BATCH_TRANSFORMS 100000
+
+// A batch of transforms with every field different, so no two slots compose the same
+static void FillBatch(TransformBatch& batch, int count)
+{
+    batch.Clear();
+    for (int i = 0; i < count; i++)
+    {
+        float position[3] = { (float)(i % 100), (float)(i % 37) * 0.5f, -(float)(i % 53) };
+        float pitchYawRoll[3] = { (float)(i % 360) * 0.0174533f, (float)(i % 180) * 0.0349066f, (float)(i % 90) * 0.0698132f };
+        float scale[3] = { 1.0f + (float)(i % 5), 0.5f + (float)(i % 3), 2.0f };
+        batch.Add(position, pitchYawRoll, scale);
+    }
+    batch.PrepareOutputs();
+}
+
+// True if every output of every slot in a and b is equal
+static bool SameOutputs(const TransformBatch& a, const TransformBatch& b)
+{
+    for (int slot = 0; slot < a.Size(); slot++)
+    {
+        float matricesA[3][16];
+        float matricesB[3][16];
+        a.GetWorldMatrix(slot, matricesA[0]);
+        a.GetWorldInverseTransposeMatrix(slot, matricesA[1]);
+        a.GetWorldInverseMatrix(slot, matricesA[2]);
+        b.GetWorldMatrix(slot, matricesB[0]);
+        b.GetWorldInverseTransposeMatrix(slot, matricesB[1]);
+        b.GetWorldInverseMatrix(slot, matricesB[2]);
+        for (int m = 0; m < 3; m++)
+        {
+            for (int k = 0; k < 16; k++)
+            {
+                if (matricesA[m][k] != matricesB[m][k]) return false;
+            }
+        }
+
+        float rotationA[4];
+        float rotationB[4];
+        a.GetRotation(slot, rotationA);
+        b.GetRotation(slot, rotationB);
+        for (int k = 0; k < 4; k++)
+        {
+            if (rotationA[k] != rotationB[k]) return false;
+        }
+    }
+    return true;
+}
+
+void RunTransformBenchmarks()
+{
+    // A count that leaves a partial register at the end, so Compose takes both paths
+    const int count = BATCH_TRANSFORMS + 5;
+    TransformBatch scalar;
+    TransformBatch composed;
+    FillBatch(scalar, count);
+    FillBatch(composed, count);
+
+    double scalarMilliseconds = BestMilliseconds(BENCHMARK_RUNS, [&]() { scalar.ComposeScalar(0, count); });
+    double composeMilliseconds = BestMilliseconds(BENCHMARK_RUNS, [&]() { composed.Compose(0, count); });
+    BENCHMARK_CHECK(SameOutputs(scalar, composed));
+
+    float matrix[16];
+    composed.GetWorldMatrix(count - 1, matrix);
+    benchmarkSink = matrix[0];
+
+#if defined(__AVX2__)
+    const char* path = "AVX2, 8 per register";
+#else
+    const char* path = "no AVX2, one at a time";
+#endif
+    printf("  %d transforms: ComposeScalar %.3f ms, Compose (%s) %.3f ms (%.2fx)\n",
+        count, scalarMilliseconds, path, composeMilliseconds, scalarMilliseconds / composeMilliseconds);
+}
\ No newline at end of file
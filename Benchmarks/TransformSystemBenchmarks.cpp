@@ -0,0 +1,74 @@
+#include "Benchmark.h"
+#include "EntityManager.h"
+#include "JobSystem.h"
+#include "TransformSystem.h"
+#include <vector>
+#include <cstring>
+#include <climits>
+#include <thread>
+
+using namespace ECS;
+using namespace DirectX;
+
+#define MOVING_TRANSFORMS 100000
+#define MOVING_FRAMES 10
+
+// Milliseconds for the fastest TransformSystem::Update over frames where every one of a crowd of
+// transforms moved, with threshold as its parallel threshold. Fills worldMatrices with where the
+// last frame left them, accessed like worldMatrices[i] for the i-th transform made
+static double MeasureMovingCrowd(int threshold, std::vector<XMFLOAT4X4>& worldMatrices)
+{
+    EntityManager em;
+    TransformSystem transformSystem(em);
+    transformSystem.SetParallelThreshold(threshold);
+    std::vector<Entity> crowd = em.Instantiate(Prefab{ Transform() }, MOVING_TRANSFORMS);
+    transformSystem.Update(em, 0);
+
+    double best = 1e30;
+    for (int frame = 1; frame <= MOVING_FRAMES; frame++)
+    {
+        em.AdvanceTick();
+        for (int i = 0; i < (int)crowd.size(); i++)
+        {
+            Transform* t = em.GetComponentForWrite<Transform>(crowd[i]);
+            TransformSystem::SetPosition(t, (float)(i % 300) + 0.1f * frame, (float)(i % 7), (float)(i / 300));
+            TransformSystem::Rotate(t, 0, 0.01f * (float)(i % 11), 0.02f);
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        transformSystem.Update(em, 1.0f / 60.0f);
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        if (elapsed < best) best = elapsed;
+    }
+
+    worldMatrices.clear();
+    for (Entity e : crowd) worldMatrices.push_back(em.GetComponent<Transform>(e)->worldMatrix);
+    return best;
+}
+
+void RunTransformSystemBenchmarks()
+{
+    // The serial path, never splitting into jobs, is the reference every worker count has to match
+    delete &JobSystem::GetInstance();
+    JobSystem::Initialize(0);
+    std::vector<XMFLOAT4X4> serialMatrices;
+    double serial = MeasureMovingCrowd(INT_MAX, serialMatrices);
+    printf("  %d moving transforms, serial path: %7.3f ms per update\n", MOVING_TRANSFORMS, serial);
+
+    int cores = (std::max)(1, (int)std::thread::hardware_concurrency());
+    int maxWorkers = (std::max)(cores, 4);
+    std::vector<XMFLOAT4X4> parallelMatrices;
+    for (int workers = 1; workers <= maxWorkers; workers *= 2)
+    {
+        delete &JobSystem::GetInstance();
+        JobSystem::Initialize(workers - 1);
+        double parallel = MeasureMovingCrowd(TRANSFORM_PARALLEL_THRESHOLD, parallelMatrices);
+        BENCHMARK_CHECK(parallelMatrices.size() == serialMatrices.size()
+            && std::memcmp(parallelMatrices.data(), serialMatrices.data(), serialMatrices.size() * sizeof(XMFLOAT4X4)) == 0);
+        printf("  %2d workers, %d per job: %7.3f ms per update (%.2fx serial)\n",
+            workers, TRANSFORM_JOB_SIZE, parallel, serial / parallel);
+    }
+    printf("  (%d hardware threads)\n", cores);
+
+    delete &JobSystem::GetInstance();
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include "Benchmark.h"
+#include <cstring>
+
+volatile float benchmarkSink;
+int benchmarkFailures;
+
+struct BenchmarkGroup
+{
+    const char* name;
+    void (*run)();
+};
+
+static const BenchmarkGroup groups[] =
+{
+    { "iteration", RunIterationBenchmarks },
+    { "churn", RunChurnBenchmarks },
+    { "query", RunQueryBenchmarks },
+    { "scheduler", RunSchedulerBenchmarks },
+    { "jobs", RunJobBenchmarks },
+    { "parallelfor", RunParallelForBenchmarks },
+    { "spawn", RunSpawnBenchmarks },
+    { "draworder", RunDrawOrderBenchmarks },
+    { "observers", RunObserverBenchmarks },
+    { "transforms", RunTransformBenchmarks },
+    { "transformsystem", RunTransformSystemBenchmarks },
+    { "hierarchy", RunHierarchyBenchmarks },
+    { "raycast", RunRaycastBenchmarks },
+};
+
+// Runs every group, or only the ones named on the command line
+int main(int argc, char** argv)
+{
+    for (const BenchmarkGroup& group : groups)
+    {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; i++)
+        {
+            if (strcmp(argv[i], group.name) == 0) selected = true;
+        }
+        if (!selected) continue;
+
+        printf("== %s\n", group.name);
+        group.run();
+    }
+
+    if (benchmarkFailures > 0) printf("%d check(s) failed\n", benchmarkFailures);
+    return benchmarkFailures == 0 ? 0 : 1;
+}
\ No newline at end of file
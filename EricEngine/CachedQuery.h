@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "ComponentPool.h"
+#include "IncrementalSort.h"
+#include "Components.h"
+
+namespace ECS
+{
+    // The set of entities that have every one of a list of component types and none of
+    // another, kept up to date by the EntityManager as components are added and removed.
+    // Reading it costs nothing extra per frame, no matter how many pools it spans.
+    class CachedQuery
+    {
+    public:
+        CachedQuery(Signature required, Signature excluded) : required(required), excluded(excluded) {}
+
+        Signature Required() const { return required; }
+        Signature Excluded() const { return excluded; }
+
+        // True if an entity with this signature belongs in the query
+        bool Matches(Signature signature) const { return (signature & (required | excluded)) == required; }
+
+        // Entity indices in the query, in no particular order
+        const std::vector<int>& Entities() const { return entities; }
+
+        // Reorders the entities by less(entityIndexA, entityIndexB). Cheap when only a few entities
+        // joined, left or changed since the last sort
+        template <class Less>
+        void Sort(Less less)
+        {
+            if (!IncrementalSort(entities, less)) return;
+            for (int i = 0; i < (int)entities.size(); i++) positions[entities[i]] = i;
+        }
+
+        // How long the first fill took, recorded by whoever filled it
+        double BuildMilliseconds() const { return buildMilliseconds; }
+        void SetBuildMilliseconds(double milliseconds) { buildMilliseconds = milliseconds; }
+
+        // Entities inserted or erased so far
+        int64_t Updates() const { return updates; }
+
+        // Time spent keeping the query up to date since the first fill, in all and during the last
+        // whole tick. The EntityManager adds to it as signatures change and ends a tick in AdvanceTick
+        double UpdateMilliseconds() const { return updateMilliseconds; }
+        double LastTickUpdateMilliseconds() const { return lastTickUpdateMilliseconds; }
+        void AddUpdateTime(double milliseconds)
+        {
+            updateMilliseconds += milliseconds;
+            tickUpdateMilliseconds += milliseconds;
+        }
+        void EndTick()
+        {
+            lastTickUpdateMilliseconds = tickUpdateMilliseconds;
+            tickUpdateMilliseconds = 0;
+        }
+
+        bool Contains(int entityIndex) const
+        {
+            return entityIndex < (int)positions.size() && positions[entityIndex] != INVALID_INDEX;
+        }
+
+        void Insert(int entityIndex)
+        {
+            if (Contains(entityIndex)) return;
+            if (entityIndex >= (int)positions.size()) positions.resize(entityIndex + 1, INVALID_INDEX);
+
+            positions[entityIndex] = (int)entities.size();
+            entities.push_back(entityIndex);
+            updates++;
+        }
+
+        void Erase(int entityIndex)
+        {
+            if (!Contains(entityIndex)) return;
+
+            // Swap the last entity into the hole to keep the list packed
+            int position = positions[entityIndex];
+            int last = entities.back();
+            entities[position] = last;
+            positions[last] = position;
+
+            entities.pop_back();
+            positions[entityIndex] = INVALID_INDEX;
+            updates++;
+        }
+
+    private:
+        Signature required;
+        Signature excluded;
+        std::vector<int> entities;
+        // Accessed like positions[entityIndex], where that entity sits in entities
+        std::vector<int> positions;
+
+        double buildMilliseconds = 0;
+        int64_t updates = 0;
+        double updateMilliseconds = 0;
+        // Time so far in the current tick, and in the one before it
+        double tickUpdateMilliseconds = 0;
+        double lastTickUpdateMilliseconds = 0;
+    };
+}
@@ -1,8 +0,0 @@
-#include "Camera.h"
-#include <iostream>
-
-int Camera::id;
-
-Camera::~Camera()
-{
-}
\ No newline at end of file
@@ -1,9 +1,8 @@
 #pragma once
 #include <DirectXMath.h>
 #include "Transform.h"
-#include "EntityManager.h"
 
-struct Camera : ECS::Component
+struct Camera
 {
 public:
     // Camera matrices
@@ -18,13 +17,5 @@ public:
     bool perspective;
 
     float orthoSize;
-
-    virtual ~Camera();
-
-    static int id;
-    virtual int ID()
-    {
-        return id;
-    }
 };
 
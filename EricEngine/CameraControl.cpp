@@ -58,14 +58,15 @@ void CameraControl::UpdateProjectionMatrix(Camera* c)
     XMStoreFloat4x4(&c->projectionMatrix, p);
 }
 
-void CameraControl::Update(float dt)
+void CameraControl::Update(EntityManager& em, float dt)
 {
-    auto cameraEntities = EntityManager::GetInstance().GetEntitiesWithComponents<Camera, Transform>();
-    if (cameraEntities.size() <= 0) return;
+    auto cameras = em.GetCachedView<Camera, Transform>();
+    if (cameras.begin() == cameras.end()) return;
 
     // We just want one camera for camera control. Pick the first one.
-    Camera* cam = EntityManager::GetInstance().GetComponent<Camera>(cameraEntities[0]);
-    Transform* transform = EntityManager::GetInstance().GetComponent<Transform>(cameraEntities[0]);
+    auto [cameraEntity, cameraComponent, transformComponent] = *cameras.begin();
+    Camera* cam = &cameraComponent;
+    Transform* transform = &transformComponent;
 
     // Get a reference to the input manager
     Input& input = Input::GetInstance();
@@ -124,8 +125,9 @@ void CameraControl::Update(float dt)
         TransformSystem::Rotate(transform, yDiff, xDiff, 0);
     }
 
-    auto pos = transform->position;
-    TransformSystem::SetPosition(transform, pos.x, pos.y, pos.z);
+    // TransformSystem leaves cameras to us so the two can run at the same time, which also
+    // means not marking the transform changed in the log it reads
+    TransformSystem::UpdateMatrices(transform);
 
     // At the end, update the view
     UpdateViewMatrix(cam, transform);
@@ -2,11 +2,12 @@
 #include <Windows.h>
 #include "Camera.h"
 #include "Transform.h"
+#include "EntityManager.h"
 
 class CameraControl
 {
 public:
-    void Update(float dt);
+    void Update(ECS::EntityManager& em, float dt);
     CameraControl(HWND hWnd, int windowWidth, int windowHeight);
 
 private:
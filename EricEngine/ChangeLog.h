@@ -0,0 +1,110 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#define INVALID_INDEX -1
+
+// Once positions reach this, the log's owner counts them from 0 again with Rebase. Far below
+// INT_MAX, and at 100k entries a tick still thousands of ticks apart
+#define CHANGE_LOG_REBASE_AT (1 << 30)
+
+namespace ECS
+{
+    // Entities in the order they were last touched, each listed at most once, so
+    // "what changed since tick t" is a binary search and then a walk over just those
+    // entities. A pool keeps one for changes and one for additions.
+    //
+    // Entries older than the window the EntityManager keeps are trimmed every tick.
+    // Removed or re-touched entities leave INVALID_INDEX behind instead of shifting the log.
+    class ChangeLog
+    {
+    public:
+        // Moves entityID to the end of the log, stamped with tick. position is the entity's
+        // own record of where it sits in the log, INVALID_INDEX if it isn't in it
+        void Record(int entityID, uint32_t tick, int& position)
+        {
+            // Already logged this tick
+            if (position >= base && ticks[position - base] == tick) return;
+
+            Erase(position);
+            position = base + (int)entities.size();
+            entities.push_back(entityID);
+            ticks.push_back(tick);
+        }
+
+        // Takes the entity at position out of the log
+        void Erase(int& position)
+        {
+            if (position >= base) entities[position - base] = INVALID_INDEX;
+            position = INVALID_INDEX;
+        }
+
+        // Drops every entry from before oldestTick
+        void Trim(uint32_t oldestTick)
+        {
+            int count = (int)(std::lower_bound(ticks.begin(), ticks.end(), oldestTick) - ticks.begin());
+            entities.erase(entities.begin(), entities.begin() + count);
+            ticks.erase(ticks.begin(), ticks.begin() + count);
+            base += count;
+            trimmedBefore = (std::max)(trimmedBefore, oldestTick);
+        }
+
+        // Drops every entry and frees the memory. Positions carry on from where they were, so
+        // positions and cursors taken before still compare correctly with later ones
+        void Clear()
+        {
+            base += (int)entities.size();
+            entities.clear();
+            ticks.clear();
+            entities.shrink_to_fit();
+            ticks.shrink_to_fit();
+        }
+
+        // Index into Entities() of the first entry stamped at or after since,
+        // or INVALID_INDEX if entries that old have already been trimmed
+        int FirstSince(uint32_t since) const
+        {
+            if (since < trimmedBefore) return INVALID_INDEX;
+            return (int)(std::lower_bound(ticks.begin(), ticks.end(), since) - ticks.begin());
+        }
+
+        // Entity ids oldest first, with INVALID_INDEX where an entry was erased
+        const std::vector<int>& Entities() const { return entities; }
+
+        // The position the next entry will get
+        int End() const { return base + (int)entities.size(); }
+
+        // Index into Entities() of the entry at position, or of the oldest entry if it's been trimmed
+        int IndexOf(int position) const { return (std::max)(position - base, 0); }
+
+        // True once positions have grown far enough that the owner should call Rebase
+        bool NeedsRebase() const { return base >= CHANGE_LOG_REBASE_AT; }
+
+        // Counts positions from the oldest entry kept again, so they never overflow. Returns how far
+        // they moved down; every position held outside the log has to go through Rebased with it
+        int Rebase()
+        {
+            int shift = base;
+            base = 0;
+            return shift;
+        }
+
+        // position after a Rebase that moved positions down by shift. Trimmed entries become
+        // INVALID_INDEX, a cursor into trimmed entries should be clamped to 0 instead
+        static int Rebased(int position, int shift) { return position >= shift ? position - shift : INVALID_INDEX; }
+
+        size_t BytesUsed() const { return entities.size() * (sizeof(int) + sizeof(uint32_t)); }
+        size_t BytesReserved() const { return entities.capacity() * sizeof(int) + ticks.capacity() * sizeof(uint32_t); }
+
+    private:
+        std::vector<int> entities;
+        // Accessed like ticks[i], when entities[i] was stamped. Never decreases
+        std::vector<uint32_t> ticks;
+        // Positions are counted from the first entry ever logged, entities[0] is at base
+        int base = 0;
+        // Entries from before this tick have been trimmed
+        uint32_t trimmedBefore = 0;
+    };
+}
\ No newline at end of file
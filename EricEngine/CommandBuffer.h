@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include <tuple>
+#include <boost/mp11.hpp>
+#include "Entity.h"
+#include "ComponentPool.h"
+#include "Components.h"
+
+namespace ECS
+{
+    // Records structural changes (destroying entities, adding and removing components) so
+    // they can be applied together at a sync point with EntityManager::FlushCommands, instead
+    // of moving pools around while something is iterating them. Get one with
+    // EntityManager::GetCommandBuffer, each thread has its own so recording never needs a lock.
+    // New entities come from EntityManager::ReserveEntity, and their components are staged here.
+    //
+    // Commands are applied in the order they were recorded. Commands aimed at an entity that
+    // is gone by the time they're applied are dropped, like the EntityManager calls they stand for.
+    class CommandBuffer
+    {
+    public:
+        void Destroy(Entity entity);
+
+        // Copies component into the buffer, it's copied again into the pool on flush
+        template <class ComponentType>
+        void AddComponent(Entity entity, const ComponentType& component);
+
+        template <class ComponentType>
+        void RemoveComponent(Entity entity);
+
+        bool Empty() const { return commands.empty(); }
+
+    private:
+        friend class EntityManager;
+
+        enum class CommandType
+        {
+            Destroy,
+            AddComponent,
+            RemoveComponent
+        };
+
+        struct Command
+        {
+            CommandType type;
+            Entity entity;
+            int componentID;
+            // Accessed like std::get<componentID>(payloads)[payload], the component to add
+            int payload;
+        };
+
+        template <class ComponentType>
+        using PayloadList = std::vector<ComponentType>;
+
+        std::vector<Command> commands;
+        boost::mp11::mp_rename<boost::mp11::mp_transform<PayloadList, ComponentList>, std::tuple> payloads;
+
+        // Forgets every command but keeps the memory for the next frame
+        void Clear();
+    };
+
+    inline void CommandBuffer::Destroy(Entity entity)
+    {
+        commands.push_back({ CommandType::Destroy, entity, INVALID_INDEX, INVALID_INDEX });
+    }
+
+    template<class ComponentType>
+    inline void CommandBuffer::AddComponent(Entity entity, const ComponentType& component)
+    {
+        auto& payloadList = std::get<ComponentID<ComponentType>>(payloads);
+        commands.push_back({ CommandType::AddComponent, entity, ComponentID<ComponentType>, (int)payloadList.size() });
+        payloadList.push_back(component);
+    }
+
+    template<class ComponentType>
+    inline void CommandBuffer::RemoveComponent(Entity entity)
+    {
+        commands.push_back({ CommandType::RemoveComponent, entity, ComponentID<ComponentType>, INVALID_INDEX });
+    }
+
+    inline void CommandBuffer::Clear()
+    {
+        commands.clear();
+        boost::mp11::tuple_for_each(payloads, [](auto& payloadList) { payloadList.clear(); });
+    }
+}
\ No newline at end of file
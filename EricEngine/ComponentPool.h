@@ -0,0 +1,455 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <cstdint>
+#include <numeric>
+#include "ChangeLog.h"
+#include "IncrementalSort.h"
+
+// How many components of one type are grouped into a single chunk
+#define COMPONENT_CHUNK_SIZE 64
+// How many entity slots each page of a pool's sparse array covers
+#define SPARSE_PAGE_SIZE 1024
+// Chunks start on their own cache line, so threads working on different chunks never share one
+#define CACHE_LINE_SIZE 64
+
+namespace ECS
+{
+    // Stores every component of one type by value as a sparse set. The dense side
+    // keeps components packed at the front of fixed-size chunks, next to a parallel
+    // array of the entity ids that own them. The sparse side maps an entity id to its
+    // dense index, which makes add, remove and membership tests O(1).
+    //
+    // Both sides grow a page/chunk at a time and give memory back as they empty, so a
+    // pool's footprint follows how many components it holds rather than a fixed maximum.
+    //
+    // The pool also logs which entities had their component added or changed at which tick.
+    template <class ComponentType>
+    class ComponentPool
+    {
+    private:
+        struct alignas(CACHE_LINE_SIZE) Chunk
+        {
+            ComponentType components[COMPONENT_CHUNK_SIZE];
+        };
+
+        struct SparsePage
+        {
+            int denseIndices[SPARSE_PAGE_SIZE];
+            // How many entities in this page's range have a component, the page is freed at 0
+            int count;
+        };
+
+        // Accessed like sparsePages[entityID / SPARSE_PAGE_SIZE]->denseIndices[entityID % SPARSE_PAGE_SIZE].
+        // Pages are only allocated while an entity in their range has a component in this pool
+        std::vector<std::unique_ptr<SparsePage>> sparsePages;
+        // Accessed like dense[denseIndex], the entity owning the component at denseIndex
+        std::vector<int> dense;
+
+        // Chunks are added as the pool grows, so adding components never moves existing ones
+        std::vector<std::unique_ptr<Chunk>> chunks;
+
+        ChangeLog changes;
+        ChangeLog additions;
+        // Accessed like changePositions[denseIndex], where that component's entity sits in changes
+        std::vector<int> changePositions;
+        std::vector<int> additionPositions;
+
+        // Chunks and sparse pages allocated so far
+        int allocations = 0;
+
+        // Where the logs ended at the last TakeEvents
+        int addedCursor = 0;
+        int changedCursor = 0;
+
+        ComponentType& At(int denseIndex)
+        {
+            return chunks[denseIndex / COMPONENT_CHUNK_SIZE]->components[denseIndex % COMPONENT_CHUNK_SIZE];
+        }
+
+        // Dense index of entityID, or INVALID_INDEX if it has no component here
+        int DenseIndex(int entityID) const
+        {
+            int page = entityID / SPARSE_PAGE_SIZE;
+            if (page >= (int)sparsePages.size() || !sparsePages[page]) return INVALID_INDEX;
+            return sparsePages[page]->denseIndices[entityID % SPARSE_PAGE_SIZE];
+        }
+
+        // Allocates entityID's sparse page if needed and points its slot at denseIndex
+        void SetDenseIndex(int entityID, int denseIndex);
+
+        // Allocates every chunk needed to hold size components
+        void AllocateChunks(int size);
+
+        // Puts component at the end of the dense side for entityID, which must not have one yet.
+        // Its chunk must already be allocated
+        template <class Component>
+        void Append(int entityID, Component&& component, uint32_t tick);
+
+    public:
+        using Type = ComponentType;
+
+        // Copies component into the pool, logs it as added and changed at tick,
+        // and returns the stored component
+        ComponentType* Add(int entityID, const ComponentType& component, uint32_t tick);
+
+        // Adds a copy of component for every entity in entityIDs, none of which may have one yet.
+        // Chunks for the whole batch are allocated up front and filled in order
+        void AddRange(const std::vector<int>& entityIDs, const ComponentType& component, uint32_t tick);
+
+        // Moves every component into target, where it belongs to entity remap[entityID], and empties
+        // this pool. Components whose remap entry is INVALID_INDEX are dropped. Moved components
+        // are logged as added at tick
+        void MoveInto(ComponentPool& target, const std::vector<int>& remap, uint32_t tick);
+
+        // Returns nullptr if the entity doesn't have this component
+        ComponentType* Get(int entityID);
+
+        bool Has(int entityID) const;
+
+        // Moves the last component into the removed one's place to keep the pool packed
+        void Remove(int entityID);
+
+        int Size() const { return (int)dense.size(); }
+
+        // How many components fit in the chunks already allocated
+        int Capacity() const { return (int)chunks.size() * COMPONENT_CHUNK_SIZE; }
+
+        // Bytes of components, indices and log entries in use, and bytes allocated for them
+        size_t BytesUsed() const;
+        size_t BytesReserved() const;
+
+        int Allocations() const { return allocations; }
+
+        // Entity ids in dense order
+        const std::vector<int>& Entities() const { return dense; }
+
+        // Logs entityID's component as changed at tick
+        void MarkChanged(int entityID, uint32_t tick);
+
+        const ChangeLog& Changes() const { return changes; }
+        const ChangeLog& Additions() const { return additions; }
+
+        // Forgets changes and additions from before oldestTick. Rebases the log positions once
+        // they grow large, so a long session never overflows them
+        void TrimLogs(uint32_t oldestTick);
+
+        // Appends the entities that got this component since the last call and still have it to added,
+        // and the ones whose component was marked changed, not counting those just added, to changed.
+        // Read from the logs, so it has to be called at least once every CHANGE_LOG_TICKS ticks
+        void TakeEvents(std::vector<int>& added, std::vector<int>& changed);
+
+        // Forgets everything that happened before now, TakeEvents reports from here on
+        void ResetEvents();
+
+        // True if entityID got this component since the last TakeEvents
+        bool AddedSinceEvents(int entityID) const
+        {
+            int denseIndex = DenseIndex(entityID);
+            return denseIndex != INVALID_INDEX && additionPositions[denseIndex] >= addedCursor;
+        }
+
+        // Reorders the pool so components are in order of less(componentA, componentB), and views
+        // walking this pool visit them in that order. Cheap when only a few components were added,
+        // removed or changed since the last sort
+        template <class Less>
+        void Sort(Less less);
+
+        // Calls func(entityID, component) for every component in the pool, in dense order.
+        // Don't remove components of this type from inside func.
+        template <class Func>
+        void ForEach(Func func);
+    };
+
+    template<class ComponentType>
+    inline void ComponentPool<ComponentType>::SetDenseIndex(int entityID, int denseIndex)
+    {
+        int page = entityID / SPARSE_PAGE_SIZE;
+        if (page >= (int)sparsePages.size()) sparsePages.resize(page + 1);
+
+        auto& sparsePage = sparsePages[page];
+        if (!sparsePage)
+        {
+            sparsePage = std::make_unique<SparsePage>();
+            std::fill(std::begin(sparsePage->denseIndices), std::end(sparsePage->denseIndices), INVALID_INDEX);
+            sparsePage->count = 0;
+            allocations++;
+        }
+
+        sparsePage->denseIndices[entityID % SPARSE_PAGE_SIZE] = denseIndex;
+        sparsePage->count++;
+    }
+
+    template<class ComponentType>
+    inline void ComponentPool<ComponentType>::AllocateChunks(int size)
+    {
+        int chunkCount = (size + COMPONENT_CHUNK_SIZE - 1) / COMPONENT_CHUNK_SIZE;
+        while ((int)chunks.size() < chunkCount)
+        {
+            chunks.push_back(std::make_unique<Chunk>());
+            allocations++;
+        }
+    }
+
+    template<class ComponentType>
+    template<class Component>
+    inline void ComponentPool<ComponentType>::Append(int entityID, Component&& component, uint32_t tick)
+    {
+        int denseIndex = (int)dense.size();
+        SetDenseIndex(entityID, denseIndex);
+        dense.push_back(entityID);
+        changePositions.push_back(INVALID_INDEX);
+        additionPositions.push_back(INVALID_INDEX);
+        At(denseIndex) = std::forward<Component>(component);
+
+        changes.Record(entityID, tick, changePositions[denseIndex]);
+        additions.Record(entityID, tick, additionPositions[denseIndex]);
+    }
+
+    template<class ComponentType>
+    inline ComponentType* ComponentPool<ComponentType>::Add(int entityID, const ComponentType& component, uint32_t tick)
+    {
+        int existing = DenseIndex(entityID);
+        if (existing != INVALID_INDEX)
+        {
+            At(existing) = component;
+            changes.Record(entityID, tick, changePositions[existing]);
+            return &At(existing);
+        }
+
+        AllocateChunks((int)dense.size() + 1);
+        Append(entityID, component, tick);
+        return &At((int)dense.size() - 1);
+    }
+
+    template<class ComponentType>
+    inline void ComponentPool<ComponentType>::AddRange(const std::vector<int>& entityIDs, const ComponentType& component, uint32_t tick)
+    {
+        int newSize = (int)dense.size() + (int)entityIDs.size();
+        AllocateChunks(newSize);
+        dense.reserve(newSize);
+        changePositions.reserve(newSize);
+        additionPositions.reserve(newSize);
+
+        for (int entityID : entityIDs) Append(entityID, component, tick);
+    }
+
+    template<class ComponentType>
+    inline void ComponentPool<ComponentType>::MoveInto(ComponentPool& target, const std::vector<int>& remap, uint32_t tick)
+    {
+        int newSize = target.Size() + Size();
+        target.AllocateChunks(newSize);
+        target.dense.reserve(newSize);
+        target.changePositions.reserve(newSize);
+        target.additionPositions.reserve(newSize);
+
+        for (int denseIndex = 0; denseIndex < Size(); denseIndex++)
+        {
+            int targetID = remap[dense[denseIndex]];
+            if (targetID != INVALID_INDEX) target.Append(targetID, std::move(At(denseIndex)), tick);
+        }
+
+        // Empty out, but keep the logs counting from where they were rather than starting over,
+        // so the cursors and anything still holding a log position stay in order with new entries
+        sparsePages.clear();
+        chunks.clear();
+        dense.clear();
+        changePositions.clear();
+        additionPositions.clear();
+        dense.shrink_to_fit();
+        changePositions.shrink_to_fit();
+        additionPositions.shrink_to_fit();
+        changes.Clear();
+        additions.Clear();
+    }
+
+    template<class ComponentType>
+    inline ComponentType* ComponentPool<ComponentType>::Get(int entityID)
+    {
+        int denseIndex = DenseIndex(entityID);
+        if (denseIndex == INVALID_INDEX) return nullptr;
+        return &At(denseIndex);
+    }
+
+    template<class ComponentType>
+    inline bool ComponentPool<ComponentType>::Has(int entityID) const
+    {
+        return DenseIndex(entityID) != INVALID_INDEX;
+    }
+
+    template<class ComponentType>
+    inline void ComponentPool<ComponentType>::Remove(int entityID)
+    {
+        int denseIndex = DenseIndex(entityID);
+        if (denseIndex == INVALID_INDEX) return;
+
+        // A removed component no longer counts as changed or added
+        changes.Erase(changePositions[denseIndex]);
+        additions.Erase(additionPositions[denseIndex]);
+
+        // Fill the hole with the last component
+        int lastIndex = (int)dense.size() - 1;
+        if (denseIndex != lastIndex)
+        {
+            At(denseIndex) = std::move(At(lastIndex));
+            dense[denseIndex] = dense[lastIndex];
+            changePositions[denseIndex] = changePositions[lastIndex];
+            additionPositions[denseIndex] = additionPositions[lastIndex];
+            sparsePages[dense[denseIndex] / SPARSE_PAGE_SIZE]->denseIndices[dense[denseIndex] % SPARSE_PAGE_SIZE] = denseIndex;
+        }
+
+        // Reset the old last slot so anything the component owns is released now
+        At(lastIndex) = ComponentType();
+        dense.pop_back();
+        changePositions.pop_back();
+        additionPositions.pop_back();
+
+        // Free the trailing chunk once a whole chunk's worth of slack is behind it,
+        // so adding and removing right at a chunk boundary doesn't thrash
+        if ((int)dense.size() + COMPONENT_CHUNK_SIZE <= ((int)chunks.size() - 1) * COMPONENT_CHUNK_SIZE)
+        {
+            chunks.pop_back();
+        }
+
+        auto& page = sparsePages[entityID / SPARSE_PAGE_SIZE];
+        page->denseIndices[entityID % SPARSE_PAGE_SIZE] = INVALID_INDEX;
+        if (--page->count == 0) page.reset();
+    }
+
+    template<class ComponentType>
+    inline void ComponentPool<ComponentType>::MarkChanged(int entityID, uint32_t tick)
+    {
+        int denseIndex = DenseIndex(entityID);
+        if (denseIndex == INVALID_INDEX) return;
+        changes.Record(entityID, tick, changePositions[denseIndex]);
+    }
+
+    template<class ComponentType>
+    inline void ComponentPool<ComponentType>::TrimLogs(uint32_t oldestTick)
+    {
+        changes.Trim(oldestTick);
+        additions.Trim(oldestTick);
+
+        if (changes.NeedsRebase())
+        {
+            int shift = changes.Rebase();
+            for (int& position : changePositions) position = ChangeLog::Rebased(position, shift);
+            changedCursor = (std::max)(changedCursor - shift, 0);
+        }
+        if (additions.NeedsRebase())
+        {
+            int shift = additions.Rebase();
+            for (int& position : additionPositions) position = ChangeLog::Rebased(position, shift);
+            addedCursor = (std::max)(addedCursor - shift, 0);
+        }
+    }
+
+    template<class ComponentType>
+    inline void ComponentPool<ComponentType>::TakeEvents(std::vector<int>& added, std::vector<int>& changed)
+    {
+        const std::vector<int>& addedIDs = additions.Entities();
+        for (int i = additions.IndexOf(addedCursor); i < (int)addedIDs.size(); i++)
+        {
+            if (addedIDs[i] != INVALID_INDEX) added.push_back(addedIDs[i]);
+        }
+
+        // Adding a component also logs it as changed, those are only reported as added
+        const std::vector<int>& changedIDs = changes.Entities();
+        for (int i = changes.IndexOf(changedCursor); i < (int)changedIDs.size(); i++)
+        {
+            if (changedIDs[i] != INVALID_INDEX && !AddedSinceEvents(changedIDs[i])) changed.push_back(changedIDs[i]);
+        }
+
+        ResetEvents();
+    }
+
+    template<class ComponentType>
+    inline void ComponentPool<ComponentType>::ResetEvents()
+    {
+        addedCursor = additions.End();
+        changedCursor = changes.End();
+    }
+
+    template<class ComponentType>
+    inline size_t ComponentPool<ComponentType>::BytesUsed() const
+    {
+        // Each component has its dense entry, two log positions and a sparse slot
+        size_t perComponent = sizeof(ComponentType) + 4 * sizeof(int);
+        return dense.size() * perComponent + changes.BytesUsed() + additions.BytesUsed();
+    }
+
+    template<class ComponentType>
+    inline size_t ComponentPool<ComponentType>::BytesReserved() const
+    {
+        int pageCount = (int)std::count_if(sparsePages.begin(), sparsePages.end(), [](const auto& page) { return page != nullptr; });
+        return chunks.size() * sizeof(Chunk) + chunks.capacity() * sizeof(chunks[0])
+            + pageCount * sizeof(SparsePage) + sparsePages.capacity() * sizeof(sparsePages[0])
+            + (dense.capacity() + changePositions.capacity() + additionPositions.capacity()) * sizeof(int)
+            + changes.BytesReserved() + additions.BytesReserved();
+    }
+
+    template<class ComponentType>
+    template<class Less>
+    inline void ComponentPool<ComponentType>::Sort(Less less)
+    {
+        // Accessed like order[denseIndex], the dense index of the component that belongs there
+        std::vector<int> order(dense.size());
+        std::iota(order.begin(), order.end(), 0);
+        if (!IncrementalSort(order, [&](int a, int b) { return less(At(a), At(b)); })) return;
+
+        // Follow each cycle of the permutation, so every component is moved once
+        for (int start = 0; start < (int)order.size(); start++)
+        {
+            if (order[start] == start) continue;
+
+            ComponentType held = std::move(At(start));
+            int heldEntity = dense[start];
+            int heldChange = changePositions[start];
+            int heldAddition = additionPositions[start];
+
+            int i = start;
+            while (order[i] != start)
+            {
+                int from = order[i];
+                At(i) = std::move(At(from));
+                dense[i] = dense[from];
+                changePositions[i] = changePositions[from];
+                additionPositions[i] = additionPositions[from];
+                order[i] = i;
+                i = from;
+            }
+
+            At(i) = std::move(held);
+            dense[i] = heldEntity;
+            changePositions[i] = heldChange;
+            additionPositions[i] = heldAddition;
+            order[i] = i;
+        }
+
+        for (int denseIndex = 0; denseIndex < (int)dense.size(); denseIndex++)
+        {
+            sparsePages[dense[denseIndex] / SPARSE_PAGE_SIZE]->denseIndices[dense[denseIndex] % SPARSE_PAGE_SIZE] = denseIndex;
+        }
+    }
+
+    template<class ComponentType>
+    template<class Func>
+    inline void ComponentPool<ComponentType>::ForEach(Func func)
+    {
+        int count = (int)dense.size();
+        for (int c = 0; c * COMPONENT_CHUNK_SIZE < count; c++)
+        {
+            ComponentType* components = chunks[c]->components;
+            int firstIndex = c * COMPONENT_CHUNK_SIZE;
+            int chunkCount = (std::min)(COMPONENT_CHUNK_SIZE, count - firstIndex);
+            for (int i = 0; i < chunkCount; i++)
+            {
+                func(dense[firstIndex + i], components[i]);
+            }
+        }
+    }
+}
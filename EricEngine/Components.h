@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <boost/mp11.hpp>
+
+#include "Mesh.h"
+#include "Transform.h"
+#include "Material.h"
+#include "Camera.h"
+#include "Light.h"
+#include "RaycastObject.h"
+#include "Parent.h"
+#include "Static.h"
+
+namespace ECS
+{
+    // Every component type the EntityManager stores. A component's id is its position
+    // in this list, and scene files store those ids, so only ever append new types.
+    // Types with no data, like RaycastObject, are tags and cost one bit per entity.
+    using ComponentList = boost::mp11::mp_list<
+        Mesh,
+        Transform,
+        Material,
+        Camera,
+        LightComponent,
+        RaycastObject,
+        Parent,
+        Static>;
+
+    constexpr int NUM_COMPONENT_TYPES = (int)boost::mp11::mp_size<ComponentList>::value;
+
+    // Accessed like ComponentNames[componentID], names for stats and tools that stay the same
+    // across compilers, unlike typeid. Keep in the same order as ComponentList
+    inline constexpr const char* ComponentNames[] = {
+        "Mesh",
+        "Transform",
+        "Material",
+        "Camera",
+        "LightComponent",
+        "RaycastObject",
+        "Parent",
+        "Static" };
+    static_assert(sizeof(ComponentNames) / sizeof(ComponentNames[0]) == NUM_COMPONENT_TYPES, "Every component type needs a name");
+
+    // Compile-time id of a component type
+    template <class ComponentType>
+    constexpr int ComponentID = (int)boost::mp11::mp_find<ComponentList, ComponentType>::value;
+
+    // One bit per component type, set if an entity has that component
+    using Signature = uint32_t;
+    static_assert(NUM_COMPONENT_TYPES <= 32, "Signature needs a bit for every component type");
+
+    // Signature with the bit of each of ComponentTypes set
+    template <class... ComponentTypes>
+    constexpr Signature SignatureOf = (Signature(0) | ... | (Signature(1) << ComponentID<ComponentTypes>));
+}
\ No newline at end of file
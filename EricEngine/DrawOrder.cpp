@@ -0,0 +1,95 @@
+#include "DrawOrder.h"
+#include <cassert>
+
+using namespace ECS;
+
+// Ids below this fit a key field of bits, its largest value is left for DRAW_KEY_NONE
+static constexpr uint32_t IdLimit(int bits) { return (1u << bits) - 1; }
+
+// The id of name, handing out the next one the first time it's seen
+static uint32_t Intern(std::unordered_map<std::string, uint32_t>& ids, const std::string& name, uint32_t limit)
+{
+    auto found = ids.find(name);
+    if (found != ids.end()) return found->second;
+
+    uint32_t id = (uint32_t)ids.size();
+    assert(id < limit && "Too many distinct names for a draw key field");
+    ids.emplace(name, id);
+    return id;
+}
+
+DrawOrder::DrawOrder()
+{
+    lastUpdateTick = 0;
+    updated = false;
+    sortedMembership = -1;
+}
+
+uint64_t DrawOrder::MakeKey(const Mesh& mesh, const Material& material)
+{
+    std::array<uint32_t, 5> textures = {
+        Intern(textureIds, material.albedoName, UINT32_MAX),
+        Intern(textureIds, material.normalsName, UINT32_MAX),
+        Intern(textureIds, material.metalnessName, UINT32_MAX),
+        Intern(textureIds, material.roughnessName, UINT32_MAX),
+        Intern(textureIds, material.aoName, UINT32_MAX) };
+    auto textureSet = textureSetIds.find(textures);
+    if (textureSet == textureSetIds.end())
+    {
+        uint32_t id = (uint32_t)textureSetIds.size();
+        assert(id < IdLimit(DRAW_KEY_TEXTURES_BITS) && "Too many distinct texture sets for a draw key");
+        textureSet = textureSetIds.emplace(textures, id).first;
+    }
+
+    uint64_t key = Intern(pixelShaderIds, material.pixelShaderName, IdLimit(DRAW_KEY_PIXEL_SHADER_BITS));
+    key = (key << DRAW_KEY_VERTEX_SHADER_BITS) | Intern(vertexShaderIds, material.vertexShaderName, IdLimit(DRAW_KEY_VERTEX_SHADER_BITS));
+    key = (key << DRAW_KEY_TEXTURES_BITS) | textureSet->second;
+    key = (key << DRAW_KEY_MESH_BITS) | Intern(meshIds, mesh.name, IdLimit(DRAW_KEY_MESH_BITS));
+    return key;
+}
+
+bool DrawOrder::Update(EntityManager& em)
+{
+    // Everything is keyed on the first update, after that only what was added or changed since
+    uint32_t since = lastUpdateTick;
+    bool everything = !updated;
+    lastUpdateTick = em.GetTick();
+    updated = true;
+    keys.resize(em.GetSlotCount(), DRAW_KEY_NONE);
+
+    bool keysChanged = false;
+    auto rekey = [&](Entity e, const Mesh& mesh, const Material& material) {
+        uint64_t key = MakeKey(mesh, material);
+        if (keys[e.Index()] == key) return;
+        keys[e.Index()] = key;
+        keysChanged = true;
+    };
+    if (everything)
+    {
+        for (auto [e, mesh, material] : em.GetView<Mesh, Material>()) rekey(e, mesh, material);
+    }
+    else
+    {
+        for (auto [e, mesh, material] : em.GetView<Mesh, Material>(Changed<Mesh>(since))) rekey(e, mesh, material);
+        for (auto [e, material, mesh] : em.GetView<Material, Mesh>(Changed<Material>(since))) rekey(e, mesh, material);
+    }
+
+    // Drawables joining or leaving the query put it out of order even when no key changed
+    int64_t membership = em.GetCachedViewUpdates<Mesh, Transform, Material>();
+    if (!keysChanged && membership == sortedMembership) return false;
+    sortedMembership = membership;
+
+    em.SortCachedViewByIndex<Mesh, Transform, Material>([this](uint32_t entityIndex) { return keys[entityIndex]; });
+    return true;
+}
+
+int DrawOrder::StateChanges(uint64_t previous, uint64_t next)
+{
+    int changes = 0;
+    bool newPixelShader = PixelShaderOf(previous) != PixelShaderOf(next);
+    if (newPixelShader) changes++;
+    if (newPixelShader || TexturesOf(previous) != TexturesOf(next)) changes++;
+    if (VertexShaderOf(previous) != VertexShaderOf(next)) changes++;
+    if (MeshOf(previous) != MeshOf(next)) changes++;
+    return changes;
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+#include "EntityManager.h"
+
+// A draw key packs the ids of the state a draw binds, most expensive to switch first, so sorting
+// by key groups draws that share it. Bits per field, from the top
+#define DRAW_KEY_PIXEL_SHADER_BITS 12
+#define DRAW_KEY_VERTEX_SHADER_BITS 12
+#define DRAW_KEY_TEXTURES_BITS 20
+#define DRAW_KEY_MESH_BITS 20
+// Never a real key, every field differs from any draw's
+#define DRAW_KEY_NONE UINT64_MAX
+
+// Keeps a draw key for every entity with a Mesh and a Material, and the renderer's draw query
+// sorted by them. Shader, texture and mesh names are turned into small integer ids once, when a
+// mesh or material is added or changed, so neither sorting nor binding compares strings
+class DrawOrder
+{
+public:
+    DrawOrder();
+
+    // Rebuilds the keys of meshes and materials added or changed since the last update, then sorts
+    // GetCachedView<Mesh, Transform, Material>() by key if any key changed or drawables came or went.
+    // Returns true if it sorted
+    bool Update(ECS::EntityManager& em);
+
+    // Key of the drawable in slot entityIndex, as of the last Update
+    uint64_t KeyOf(uint32_t entityIndex) const { return keys[entityIndex]; }
+
+    static uint32_t PixelShaderOf(uint64_t key) { return (uint32_t)(key >> (64 - DRAW_KEY_PIXEL_SHADER_BITS)); }
+    static uint32_t VertexShaderOf(uint64_t key) { return (uint32_t)(key >> (DRAW_KEY_TEXTURES_BITS + DRAW_KEY_MESH_BITS)) & ((1u << DRAW_KEY_VERTEX_SHADER_BITS) - 1); }
+    static uint32_t TexturesOf(uint64_t key) { return (uint32_t)(key >> DRAW_KEY_MESH_BITS) & ((1u << DRAW_KEY_TEXTURES_BITS) - 1); }
+    static uint32_t MeshOf(uint64_t key) { return (uint32_t)key & ((1u << DRAW_KEY_MESH_BITS) - 1); }
+
+    // Binds the renderer makes going from a draw with key previous to one with key next. A new pixel
+    // shader also rebinds textures, since another shader can expect them in other slots
+    static int StateChanges(uint64_t previous, uint64_t next);
+
+private:
+    // Tick of the last Update, meshes and materials changed before it already have their keys
+    uint32_t lastUpdateTick;
+    bool updated;
+    // The draw query's joins and leaves when it was last sorted
+    int64_t sortedMembership;
+
+    // Accessed like keys[entityIndex]
+    std::vector<uint64_t> keys;
+
+    // Ids handed out for each kind of state, by name
+    std::unordered_map<std::string, uint32_t> pixelShaderIds;
+    std::unordered_map<std::string, uint32_t> vertexShaderIds;
+    std::unordered_map<std::string, uint32_t> textureIds;
+    std::unordered_map<std::string, uint32_t> meshIds;
+    // A material's five textures are bound together, so each distinct set of them gets one id
+    std::map<std::array<uint32_t, 5>, uint32_t> textureSetIds;
+
+    uint64_t MakeKey(const Mesh& mesh, const Material& material);
+};
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+// An entity handle is 32 bits: the low bits are the entity's slot index,
+// the high bits are the generation of that slot when the handle was made
+#define ENTITY_INDEX_BITS 20
+#define ENTITY_INDEX_MASK ((1u << ENTITY_INDEX_BITS) - 1)
+#define ENTITY_GENERATION_MASK (0xFFFFFFFFu >> ENTITY_INDEX_BITS)
+
+namespace ECS
+{
+    // A slot's generation changes every time the entity in it is destroyed,
+    // so old handles to a reused slot stop matching instead of silently
+    // pointing at whatever entity lives there now
+    struct Entity
+    {
+        uint32_t handle;
+
+        uint32_t Index() const { return handle & ENTITY_INDEX_MASK; }
+        uint32_t Generation() const { return handle >> ENTITY_INDEX_BITS; }
+
+        static Entity Make(uint32_t index, uint32_t generation)
+        {
+            return { (generation << ENTITY_INDEX_BITS) | (index & ENTITY_INDEX_MASK) };
+        }
+
+        bool operator==(const Entity& other) const { return handle == other.handle; }
+        bool operator!=(const Entity& other) const { return handle != other.handle; }
+    };
+
+    // Never handed out, IsAlive always rejects it
+    constexpr Entity INVALID_ENTITY = { 0xFFFFFFFF };
+}
@@ -1,130 +1,539 @@
 #include "EntityManager.h"
 
+// Signature scans compare 8 entities at a time with AVX2 (the x64 builds compile with
+// /arch:AVX2), 4 with SSE2, and fall back to one at a time anywhere else
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ECS_SIGNATURE_SSE2
+#include <emmintrin.h>
+#endif
+
 using namespace ECS;
 
-EntityManager* EntityManager::instance;
-int EntityManager::numComponentTypes;
+std::atomic<int> EntityManager::numQueryTypes;
+std::atomic<int> EntityManager::numManagers;
+
+ECS::EntityManager::EntityManager()
+{
+    entityCount = 0;
+    freeCursor = 0;
+    notifying = false;
+    nextObserverID = 0;
+    tick = 0;
+    serial = numManagers++;
+
+    queriesByComponent.resize(NUM_COMPONENT_TYPES);
+    observers.resize(NUM_COMPONENT_TYPES);
+}
+
+ECS::EntityManager::~EntityManager()
+{
+    DeregisterAllEntities();
+}
+
+Entity ECS::EntityManager::RegisterNewEntity()
+{
+    ECS_CHECK_STRUCTURAL_CHANGE();
+
+    Entity entity = ReserveEntity();
+    MaterializeReservedEntities();
+    return entity;
+}
+
+uint32_t ECS::EntityManager::ReservedIndex(int position) const
+{
+    // Reuse freed slots first, then take untouched slots past the end. -1 is the first of those
+    if (position >= 0) return freeIndices[position];
+    return (uint32_t)((int)generations.size() - position - 1);
+}
+
+Entity ECS::EntityManager::ReserveEntity()
+{
+    int position = freeCursor.fetch_sub(1, std::memory_order_relaxed) - 1;
+    uint32_t index = ReservedIndex(position);
+
+    // The last index is reserved for INVALID_ENTITY
+    if (index >= ENTITY_INDEX_MASK) return INVALID_ENTITY;
+    // Untouched slots start at generation 0
+    return Entity::Make(index, index < generations.size() ? generations[index] : 0);
+}
+
+void ECS::EntityManager::MaterializeReservedEntities()
+{
+    int position = freeCursor.load(std::memory_order_relaxed);
+    int freeCount = (int)freeIndices.size();
+    if (position == freeCount) return;
+
+    // Reserved freed slots are the end of the free list
+    int firstReused = (std::max)(position, 0);
+    for (int i = firstReused; i < freeCount; i++) alive[freeIndices[i]] = true;
+    entityCount += freeCount - firstReused;
+    freeIndices.resize(firstReused);
+
+    if (position < 0)
+    {
+        int first = (int)generations.size();
+        int fresh = (std::min)(-position, (int)ENTITY_INDEX_MASK - first);
+        generations.resize(first + fresh, 0);
+        alive.resize(first + fresh, true);
+        signatures.resize(first + fresh, 0);
+        entityCount += fresh;
+    }
+
+    freeCursor.store((int)freeIndices.size(), std::memory_order_relaxed);
+}
+
+void ECS::EntityManager::DeregisterEntity(Entity entity)
+{
+    ECS_CHECK_STRUCTURAL_CHANGE();
+    MaterializeReservedEntities();
+
+    // Stale handles don't get to touch whatever lives in their slot now
+    if (!IsAlive(entity)) return;
+
+    uint32_t index = entity.Index();
+    // Clear out any valid components, the signature says which pools to visit
+    Signature signature = signatures[index];
+    signatures[index] = 0;
+    boost::mp11::tuple_for_each(componentPools, [&](auto& pool) {
+        constexpr int componentID = ComponentID<typename std::decay_t<decltype(pool)>::Type>;
+        if (!((signature >> componentID) & 1)) return;
+        OnSignatureChanged(componentID, index);
+        RecordRemoval(pool, entity);
+        pool.Remove(index);
+    });
+
+    // Invalidate every outstanding handle to this slot, then make it reusable
+    generations[index] = (generations[index] + 1) & ENTITY_GENERATION_MASK;
+    alive[index] = false;
+    freeIndices.push_back(index);
+    freeCursor.store((int)freeIndices.size(), std::memory_order_relaxed);
 
-int ECS::EntityManager::GetID()
+    entityCount--;
+}
+
+void ECS::EntityManager::DeregisterAllEntities()
+{
+    MaterializeReservedEntities();
+
+    std::vector<Entity> entities;
+    entities.reserve(entityCount);
+    for (uint32_t i = 0; i < generations.size(); i++)
+    {
+        // Deregister each entity that exists
+        if (alive[i]) entities.push_back(HandleAt(i));
+    }
+    DeregisterEntities(entities);
+}
+
+void ECS::EntityManager::AllocateSlots(int count, std::vector<int>& entityIndices)
+{
+    // Earlier reservations are settled first, so the batch is reserved in one step
+    MaterializeReservedEntities();
+
+    entityIndices.reserve(entityIndices.size() + count);
+    int position = freeCursor.fetch_sub(count, std::memory_order_relaxed);
+    for (int i = 1; i <= count; i++)
+    {
+        uint32_t index = ReservedIndex(position - i);
+        // The last index is reserved for INVALID_ENTITY
+        if (index >= ENTITY_INDEX_MASK) break;
+        entityIndices.push_back(index);
+    }
+
+    MaterializeReservedEntities();
+}
+
+std::vector<Entity> ECS::EntityManager::MergeInto(EntityManager& target)
 {
-    int eid = FIRST_VALID_ENTITY;
+    ECS_CHECK_STRUCTURAL_CHANGE();
+    assert(&target != this && "An EntityManager can't merge into itself");
+    MaterializeReservedEntities();
 
-    if (eid >= MAX_ENTITIES || entities[eid])
+    std::vector<Entity> entities;
+    entities.reserve(entityCount);
+    for (uint32_t i = 0; i < generations.size(); i++)
     {
-        for (; eid < MAX_ENTITIES; eid++)
+        if (alive[i]) entities.push_back(HandleAt(i));
+    }
+
+    std::vector<int> targetIndices;
+    target.AllocateSlots((int)entities.size(), targetIndices);
+
+    // Accessed like remap[index], the slot in target the entity in slot index moves to
+    std::vector<int> remap(generations.size(), INVALID_INDEX);
+    std::vector<Entity> moved(generations.size(), INVALID_ENTITY);
+    Signature touched = 0;
+    for (int i = 0; i < (int)targetIndices.size(); i++)
+    {
+        uint32_t index = entities[i].Index();
+        remap[index] = targetIndices[i];
+        moved[index] = target.HandleAt(targetIndices[i]);
+        target.signatures[targetIndices[i]] = signatures[index];
+        touched |= signatures[index];
+    }
+
+    boost::mp11::tuple_for_each(componentPools, [&](auto& pool) {
+        constexpr int componentID = ComponentID<typename std::decay_t<decltype(pool)>::Type>;
+        pool.MoveInto(std::get<componentID>(target.componentPools), remap, target.tick);
+    });
+    target.OnSignaturesChanged(touched, targetIndices);
+
+    // Parents still name slots in this manager, point them at where their entity moved. Checked
+    // before the slots are freed, so a stale handle can't pass for the entity now in its slot
+    if (touched & SignatureOf<Parent>)
+    {
+        for (int i = 0; i < (int)targetIndices.size(); i++)
         {
-            // If we found an empty slot, use it
-            if (!entities[eid]) return eid;
+            Parent* parent = target.GetComponent<Parent>(moved[entities[i].Index()]);
+            if (parent == nullptr) continue;
+            parent->entity = IsAlive(parent->entity) ? moved[parent->entity.Index()] : INVALID_ENTITY;
         }
-
-        // We didn't find an open slot, so we have no room for additional entities.
-        eid = INVALID_ENTITY;
     }
 
-    return eid;
+    // The pools are already empty, this only frees the slots and updates cached queries
+    DeregisterEntities(entities);
+    return moved;
 }
 
-ECS::EntityManager::EntityManager() : entities()
+void ECS::EntityManager::DeregisterEntities(const std::vector<Entity>& entities)
 {
-    entityCount = 0;
+    ECS_CHECK_STRUCTURAL_CHANGE();
+    MaterializeReservedEntities();
 
-    // Allocate component memory
-    // Each component has a full array,
-    // where every entity has one slot
-    components.resize(numComponentTypes);
-    int max = EntityManager::numComponentTypes;
-    for (int i = 0; i < max; i++)
+    std::vector<int> indices;
+    indices.reserve(entities.size());
+    // The live handles, alongside indices, for OnRemove observers
+    std::vector<Entity> removed;
+    removed.reserve(entities.size());
+    // Every component any of the entities has, so pools nobody uses are skipped
+    Signature touched = 0;
+    for (Entity entity : entities)
     {
-        components[i].resize(MAX_ENTITIES);
-        for (int j = 0; j < MAX_ENTITIES; j++)
+        if (!IsAlive(entity)) continue;
+
+        uint32_t index = entity.Index();
+        indices.push_back(index);
+        removed.push_back(entity);
+        touched |= signatures[index];
+        // Invalidate handles right away, so an entity listed twice is only cleared once
+        generations[index] = (generations[index] + 1) & ENTITY_GENERATION_MASK;
+        alive[index] = false;
+    }
+
+    boost::mp11::tuple_for_each(componentPools, [&](auto& pool) {
+        constexpr int componentID = ComponentID<typename std::decay_t<decltype(pool)>::Type>;
+        if (!((touched >> componentID) & 1)) return;
+        for (int i = 0; i < (int)indices.size(); i++)
         {
-            components[i][j] = new Component();
+            if (!((signatures[indices[i]] >> componentID) & 1)) continue;
+            RecordRemoval(pool, removed[i]);
+            pool.Remove(indices[i]);
         }
+    });
+
+    for (int index : indices) signatures[index] = 0;
+    OnSignaturesChanged(touched, indices);
+
+    freeIndices.insert(freeIndices.end(), indices.begin(), indices.end());
+    freeCursor.store((int)freeIndices.size(), std::memory_order_relaxed);
+    entityCount -= (int)indices.size();
+}
+
+CommandBuffer& ECS::EntityManager::GetCommandBuffer()
+{
+    // Remember the last buffer this thread got so the common case takes no lock
+    thread_local int cachedSerial = -1;
+    thread_local CommandBuffer* cachedBuffer = nullptr;
+    if (cachedSerial == serial) return *cachedBuffer;
+
+    std::lock_guard<std::mutex> lock(commandBuffersMutex);
+    CommandBuffer*& buffer = commandBuffersByThread[std::this_thread::get_id()];
+    if (buffer == nullptr)
+    {
+        commandBuffers.push_back(std::make_unique<CommandBuffer>());
+        buffer = commandBuffers.back().get();
     }
 
-    // Allocate space for index vectors
-    componentEntityIDs.resize(EntityManager::numComponentTypes);
+    cachedSerial = serial;
+    cachedBuffer = buffer;
+    return *buffer;
 }
 
-ECS::EntityManager::~EntityManager()
+void ECS::EntityManager::FlushCommands()
 {
-    DeregisterAllEntities();
+    // Reserved entities go live before the commands that were recorded for them
+    MaterializeReservedEntities();
 
-    for (int cid = 0; cid < numComponentTypes; cid++)
     {
-        for (int eid = 0; eid < MAX_ENTITIES; eid++)
+        std::lock_guard<std::mutex> lock(commandBuffersMutex);
+        for (auto& buffer : commandBuffers)
         {
-            if (components[cid][eid]->ID() != MESH_ID) delete components[cid][eid];
+            if (buffer->Empty()) continue;
+            ApplyCommands(*buffer);
+            buffer->Clear();
         }
     }
+
+    // Outside the lock, observers may want a command buffer
+    NotifyObservers();
 }
 
-EntityManager& ECS::EntityManager::GetInstance()
+void ECS::EntityManager::NotifyObservers()
 {
-    if (!instance) instance = new EntityManager();
-    return *instance;
+    std::vector<int> added;
+    std::vector<int> changed;
+    std::vector<Entity> handles;
+
+    // Observers registered from here on are held back, so the lists stay put while they're called
+    notifying = true;
+    auto notify = [](const std::vector<RegisteredObserver>& list, const std::vector<Entity>& batch) {
+        if (batch.empty()) return;
+        for (const RegisteredObserver& observer : list)
+        {
+            // Removed by an observer called earlier in this flush
+            if (observer.callback) observer.callback(batch);
+        }
+    };
+
+    boost::mp11::tuple_for_each(componentPools, [&](auto& pool) {
+        constexpr int componentID = ComponentID<typename std::decay_t<decltype(pool)>::Type>;
+        Observers& watchers = observers[componentID];
+        if (watchers.Empty()) return;
+
+        // Events past this point, including any the observers cause, wait for the next flush
+        added.clear();
+        changed.clear();
+        pool.TakeEvents(added, changed);
+        std::vector<Entity> removed;
+        removed.swap(watchers.removed);
+
+        notify(watchers.onRemove, removed);
+
+        handles.clear();
+        for (int index : added) handles.push_back(HandleAt(index));
+        notify(watchers.onAdd, handles);
+
+        handles.clear();
+        for (int index : changed) handles.push_back(HandleAt(index));
+        notify(watchers.onChange, handles);
+    });
+    notifying = false;
+
+    // Observers removed during the flush leave their lists, and ones registered join them
+    auto settle = [](std::vector<RegisteredObserver>& pending, std::vector<RegisteredObserver>& list) {
+        list.erase(std::remove_if(list.begin(), list.end(), [](const RegisteredObserver& observer) { return !observer.callback; }), list.end());
+        std::move(pending.begin(), pending.end(), std::back_inserter(list));
+        pending.clear();
+    };
+    for (Observers& watchers : observers)
+    {
+        settle(watchers.pendingOnAdd, watchers.onAdd);
+        settle(watchers.pendingOnRemove, watchers.onRemove);
+        settle(watchers.pendingOnChange, watchers.onChange);
+    }
 }
 
-int ECS::EntityManager::RegisterNewEntity()
+void ECS::EntityManager::RemoveObserver(ObserverID id)
 {
-    int id = GetID();
-    entities[id] = true;
-    entityCount++;
-    return id;
+    for (Observers& watchers : observers)
+    {
+        std::vector<RegisteredObserver>* lists[] = { &watchers.onAdd, &watchers.onRemove, &watchers.onChange,
+            &watchers.pendingOnAdd, &watchers.pendingOnRemove, &watchers.pendingOnChange };
+        for (std::vector<RegisteredObserver>* list : lists)
+        {
+            auto found = std::find_if(list->begin(), list->end(), [id](const RegisteredObserver& observer) { return observer.id == id; });
+            if (found == list->end()) continue;
+
+            // A list being walked can't shrink, so the observer is only emptied until the flush is over
+            if (notifying) found->callback = nullptr;
+            else list->erase(found);
+
+            // Nobody is left to report removals to
+            if (watchers.onRemove.empty() && watchers.pendingOnRemove.empty()) watchers.removed.clear();
+            return;
+        }
+    }
 }
 
-void ECS::EntityManager::DeregisterEntity(int id)
+void ECS::EntityManager::ApplyCommands(CommandBuffer& buffer)
 {
-    entities[id] = false;
-    // Clear out any valid components
-    for (int i = 0; i < EntityManager::numComponentTypes; i++)
+    using CommandType = CommandBuffer::CommandType;
+
+    for (const auto& command : buffer.commands)
     {
-        auto component = components[i][id];
-        if (component == nullptr) continue;
+        Entity entity = command.entity;
 
-        if (component->ID() != INVALID_COMPONENT)
+        switch (command.type)
         {
-            auto& entitiesVec = componentEntityIDs[i];
-            auto it = std::find(entitiesVec.begin(), entitiesVec.end(), id);
-            if (it != entitiesVec.end())
-                entitiesVec.erase(it);
-            if (components[i][id]->ID() != MESH_ID) delete components[i][id];
-            components[i][id] = new Component();
+        case CommandType::Destroy:
+            DeregisterEntity(entity);
+            break;
+        case CommandType::AddComponent:
+            boost::mp11::mp_with_index<NUM_COMPONENT_TYPES>(command.componentID, [&](auto I) {
+                AddComponent(entity, std::get<I>(buffer.payloads)[command.payload]);
+            });
+            break;
+        case CommandType::RemoveComponent:
+            boost::mp11::mp_with_index<NUM_COMPONENT_TYPES>(command.componentID, [&](auto I) {
+                RemoveComponent<boost::mp11::mp_at_c<ComponentList, I>>(entity);
+            });
+            break;
         }
     }
+}
 
-    entityCount--;
+void ECS::EntityManager::AdvanceTick()
+{
+    {
+        std::lock_guard<std::mutex> lock(cachedQueriesMutex);
+        for (const auto& query : cachedQueries)
+        {
+            if (query) query->EndTick();
+        }
+    }
+
+    tick++;
+    if (tick < CHANGE_LOG_TICKS) return;
+
+    uint32_t oldestTick = tick - CHANGE_LOG_TICKS + 1;
+    boost::mp11::tuple_for_each(componentPools, [&](auto& pool) { pool.TrimLogs(oldestTick); });
 }
 
-void ECS::EntityManager::DeregisterAllEntities()
+EntityManagerStats ECS::EntityManager::GetStats()
 {
-    for (int i = 0; i < MAX_ENTITIES; i++) 
+    EntityManagerStats stats;
+    stats.entityCount = entityCount;
+    stats.slotCount = (int)generations.size();
+    stats.freeSlots = (int)freeIndices.size();
+    stats.slotBytes = generations.capacity() * sizeof(uint32_t) + alive.capacity() / 8
+        + signatures.capacity() * sizeof(Signature) + freeIndices.capacity() * sizeof(uint32_t);
+
+    boost::mp11::tuple_for_each(componentPools, [&](auto& pool) {
+        using ComponentType = typename std::decay_t<decltype(pool)>::Type;
+        PoolStats poolStats;
+        poolStats.name = ComponentNames[ComponentID<ComponentType>];
+        poolStats.componentID = ComponentID<ComponentType>;
+        poolStats.tag = IsTag<ComponentType>;
+        poolStats.count = pool.Size();
+        poolStats.capacity = pool.Capacity();
+        poolStats.bytesUsed = pool.BytesUsed();
+        poolStats.bytesReserved = pool.BytesReserved();
+        poolStats.fragmentation = poolStats.bytesReserved == 0 ? 0.0f : 1.0f - (float)poolStats.bytesUsed / poolStats.bytesReserved;
+        poolStats.allocations = pool.Allocations();
+        stats.pools.push_back(poolStats);
+    });
+
+    std::lock_guard<std::mutex> lock(cachedQueriesMutex);
+    for (const auto& query : cachedQueries)
     {
-        // Deregister each entity that exists
-        if (entities[i]) DeregisterEntity(i);
+        // Query ids are shared between EntityManagers, so this one may not have made them all
+        if (!query) continue;
+        stats.queries.push_back({ query->Required(), query->Excluded(), (int)query->Entities().size(),
+            query->BuildMilliseconds(), query->Updates(), query->UpdateMilliseconds(), query->LastTickUpdateMilliseconds() });
     }
+
+    return stats;
 }
 
-void ECS::EntityManager::AddComponent(int componentID, int entityID, Component* component)
+Entity ECS::EntityManager::GetEntity(int index) const
 {
-    // Only add components to existing entities
-    if (!entities[entityID]) return;
-    // Don't allow double adding of components
-    if (components[componentID][entityID]->ID() != INVALID_COMPONENT) return;
+    if (index < 0 || index >= (int)generations.size() || !alive[index]) return INVALID_ENTITY;
+    return HandleAt(index);
+}
+
+void ECS::EntityManager::OnSignatureChanged(int componentID, int entityIndex)
+{
+    // Only queries that require or exclude this component can change their mind
+    const std::vector<CachedQuery*>& queries = queriesByComponent[componentID];
+    if (queries.empty()) return;
+
+    // Each query is timed from where the one before it finished
+    auto start = std::chrono::high_resolution_clock::now();
+    for (CachedQuery* query : queries)
+    {
+        if (query->Matches(signatures[entityIndex])) query->Insert(entityIndex);
+        else query->Erase(entityIndex);
+
+        auto end = std::chrono::high_resolution_clock::now();
+        query->AddUpdateTime(std::chrono::duration<double, std::milli>(end - start).count());
+        start = end;
+    }
+}
+
+void ECS::EntityManager::OnSignaturesChanged(Signature changed, const std::vector<int>& entityIndices)
+{
+    // A query that cares about several of the changed components is still only visited once
+    std::vector<CachedQuery*> queries;
+    for (int componentID = 0; componentID < NUM_COMPONENT_TYPES; componentID++)
+    {
+        if (!((changed >> componentID) & 1)) continue;
+        for (CachedQuery* query : queriesByComponent[componentID])
+        {
+            if (std::find(queries.begin(), queries.end(), query) == queries.end()) queries.push_back(query);
+        }
+    }
 
-    // Delete empty component
-    if (components[componentID][entityID]->ID() != MESH_ID) delete components[componentID][entityID];
+    for (CachedQuery* query : queries)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int index : entityIndices)
+        {
+            if (query->Matches(signatures[index])) query->Insert(index);
+            else query->Erase(index);
+        }
+        query->AddUpdateTime(std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - start).count());
+    }
+}
 
-    components[componentID][entityID] = component;
+void ECS::EntityManager::FindEntities(Signature required, Signature excluded, std::vector<Entity>& matches) const
+{
+    // A signature matches when masking it leaves exactly the required bits
+    Signature mask = required | excluded;
+    const Signature* slots = signatures.data();
+    int count = (int)signatures.size();
+    int i = 0;
 
-    // We've added a component here, need to keep track of it
-    auto& entityIDs = componentEntityIDs[componentID];
-    entityIDs.push_back(entityID);
-    std::sort(entityIDs.begin(), entityIDs.end());
+#if defined(__AVX2__)
+    __m256i wideMask = _mm256_set1_epi32((int)mask);
+    __m256i wideRequired = _mm256_set1_epi32((int)required);
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(slots + i));
+        __m256i equal = _mm256_cmpeq_epi32(_mm256_and_si256(block, wideMask), wideRequired);
+        // One bit per entity in the block
+        int hits = _mm256_movemask_ps(_mm256_castsi256_ps(equal));
+        for (int lane = 0; hits != 0; lane++, hits >>= 1)
+        {
+            if (hits & 1) matches.push_back(HandleAt(i + lane));
+        }
+    }
+#elif defined(ECS_SIGNATURE_SSE2)
+    __m128i wideMask = _mm_set1_epi32((int)mask);
+    __m128i wideRequired = _mm_set1_epi32((int)required);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i*)(slots + i));
+        __m128i equal = _mm_cmpeq_epi32(_mm_and_si128(block, wideMask), wideRequired);
+        // One bit per entity in the block
+        int hits = _mm_movemask_ps(_mm_castsi128_ps(equal));
+        for (int lane = 0; hits != 0; lane++, hits >>= 1)
+        {
+            if (hits & 1) matches.push_back(HandleAt(i + lane));
+        }
+    }
+#endif
+
+    // Whatever didn't fill a whole block
+    for (; i < count; i++)
+    {
+        if ((slots[i] & mask) == required) matches.push_back(HandleAt(i));
+    }
 }
 
-bool ECS::EntityManager::EntityHasComponent(int componentID, int entityID)
+bool ECS::EntityManager::EntityHasComponent(int componentID, Entity entity)
 {
-    // If this is not true, there is no component there
-    return components[componentID][entityID]->ID() == componentID;
+    return IsAlive(entity) && EntityHasComponentAtIndex(componentID, entity.Index());
 }
\ No newline at end of file
@@ -7,169 +7,654 @@
 #include <algorithm>
 #include <tuple>
 #include <iterator>
+#include <memory>
+#include <cassert>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <functional>
 #include <boost/mp11.hpp>
-#include <boost/range/algorithm/set_algorithm.hpp>
-
-#define MAX_ENTITIES 4096
-
-#define INVALID_ENTITY -1
-#define FIRST_VALID_ENTITY INVALID_ENTITY+1
+#include "Entity.h"
+#include "ComponentPool.h"
+#include "TagPool.h"
+#include "View.h"
+#include "CachedQuery.h"
+#include "EntityManagerStats.h"
+#include "CommandBuffer.h"
+#include "Prefab.h"
+#include "Components.h"
+#include "SystemAccess.h"
+#include "JobSystem.h"
 
 #define INVALID_COMPONENT -1
-
-#define MESH_ID 0
+// How many ticks of component changes and additions are kept for Changed and Added queries
+#define CHANGE_LOG_TICKS 4
 
 namespace ECS
 {
-    struct Component
-    {
-        virtual int ID() { return INVALID_COMPONENT; }
-        virtual ~Component() {}
-    };
-
+    // Called with a batch of entities, see EntityManager::OnAdd
+    using ComponentObserver = std::function<void(const std::vector<Entity>&)>;
+    // Returned by OnAdd, OnRemove and OnChange, to unregister the observer with RemoveObserver
+    using ObserverID = int;
+
+    // A world of entities and their components. Each EntityManager owns all of its own storage,
+    // so several can exist at once: a scene can be built in one off the main thread and moved
+    // into the live one with MergeInto, or independent simulations can each run in their own.
+    // One EntityManager must only be changed by one thread at a time, systems on a Scheduler
+    // get that through its access rules and command buffers.
     class EntityManager
     {
     private:
-        std::vector<std::vector<int>*> vectorsToIntersect;
+        // Current generation of every entity slot. A handle is alive only while
+        // its generation matches, and a slot's generation is bumped when it's freed.
+        // Slot arrays grow as new slots are needed, components live in the pools' own pages
+        std::vector<uint32_t> generations;
+        // Whether each slot currently holds an entity
+        std::vector<bool> alive;
+        // Freed slots waiting to be reused
+        std::vector<uint32_t> freeIndices;
+        // ReserveEntity counts this down to hand out slots without a lock. Positions 0 and up are
+        // taken from freeIndices, negative ones are untouched slots past the end of generations.
+        // Reset to freeIndices.size() whenever reserved entities are made real
+        std::atomic<int> freeCursor;
+        // Accessed like signatures[entityIndex], which components each slot has.
+        // Kept packed so queries can test several entities per instruction
+        std::vector<Signature> signatures;
+
+        int entityCount;
 
-        static EntityManager* instance;
+        // Stamped on every component added or marked changed, advanced once per frame
+        uint32_t tick;
+
+        // One pool per component type, accessed like std::get<ComponentID<T>>(componentPools).
+        // Each ComponentPool keeps its components packed by value in chunks, so each component type
+        // has contiguous memory. Tags are TagPools, a bit per entity. Finding a type's pool is
+        // resolved at compile time
+        boost::mp11::mp_rename<boost::mp11::mp_transform<PoolFor, ComponentList>, std::tuple> componentPools;
+
+        // Accessed like cachedQueries[queryID]. Every distinct component list passed to
+        // GetCachedView gets its own query id the first time it's used
+        std::vector<std::unique_ptr<CachedQuery>> cachedQueries;
+        // Accessed like queriesByComponent[componentID], the cached queries that require or exclude that component
+        std::vector<std::vector<CachedQuery*>> queriesByComponent;
+        static std::atomic<int> numQueryTypes;
+        // Systems running in parallel can look up, and make, cached queries at the same time
+        std::mutex cachedQueriesMutex;
+
+        bool EntityHasComponentAtIndex(int componentID, int entityIndex) const
+        {
+            return (signatures[entityIndex] >> componentID) & 1;
+        }
 
-        // Find an empty id slot to add an entity to.
-        int GetID();
+        // Keeps cached queries in sync after componentID's bit in an entity's signature changes
+        void OnSignatureChanged(int componentID, int entityIndex);
+        // Like OnSignatureChanged for a batch of entities whose signatures changed by the bits in changed.
+        // Each affected query is visited once for the whole batch
+        void OnSignaturesChanged(Signature changed, const std::vector<int>& entityIndices);
 
-        // Array of component arrays. Accessed like components[componentID][entityID], so each
-        // component has a contiguous block of memory
-        std::vector<std::vector<Component*>> components;
+        // Takes up to count slots for new entities, at once, and appends their indices to entityIndices
+        void AllocateSlots(int count, std::vector<int>& entityIndices);
 
-        // Initializes this entity manager
-        EntityManager();
+        // The slot handed out for freeCursor position
+        uint32_t ReservedIndex(int position) const;
+        // Makes every entity reserved so far alive. Called before anything else changes the slots
+        void MaterializeReservedEntities();
 
-        static int numComponentTypes;
+        // The cached query GetCachedView<ComponentTypes...>(Without<...>) walks, made and filled on first use
+        template <class... ComponentTypes, class... ExcludedTypes>
+        CachedQuery& GetCachedQuery(Without<ExcludedTypes...> without);
 
-        // Keep track of where valid components actually are so we
-        // can iterate through them
-        std::vector<std::vector<int>> componentEntityIDs;
+        // Appends every live entity that has all of required and none of excluded to matches,
+        // comparing several signatures per instruction where SIMD is available
+        void FindEntities(Signature required, Signature excluded, std::vector<Entity>& matches) const;
 
-    public:
-        ~EntityManager();
+        // Every thread's command buffer, in the order threads first asked for one
+        std::vector<std::unique_ptr<CommandBuffer>> commandBuffers;
+        std::unordered_map<std::thread::id, CommandBuffer*> commandBuffersByThread;
+        std::mutex commandBuffersMutex;
+        // Unique per EntityManager ever made, so a thread's cached buffer can't outlive its owner
+        int serial;
+        static std::atomic<int> numManagers;
 
-        bool entities[MAX_ENTITIES];
-        int entityCount;
+        void ApplyCommands(CommandBuffer& buffer);
 
-        // ComponentContainer Singleton
-        static EntityManager& GetInstance();
+        struct RegisteredObserver
+        {
+            ObserverID id;
+            // Empty once removed while observers were being called, dropped from its list afterwards
+            ComponentObserver callback;
+        };
+        struct Observers
+        {
+            std::vector<RegisteredObserver> onAdd;
+            std::vector<RegisteredObserver> onRemove;
+            std::vector<RegisteredObserver> onChange;
+            // Registered while observers were being called, and moved in above once they're all done,
+            // so no list grows while one of its observers is running
+            std::vector<RegisteredObserver> pendingOnAdd;
+            std::vector<RegisteredObserver> pendingOnRemove;
+            std::vector<RegisteredObserver> pendingOnChange;
+            // Entities that lost the component since the last flush, waiting for onRemove
+            std::vector<Entity> removed;
+
+            bool Empty() const { return onAdd.empty() && onRemove.empty() && onChange.empty(); }
+            bool AnyPending() const { return !pendingOnAdd.empty() || !pendingOnRemove.empty() || !pendingOnChange.empty(); }
+        };
+        // Accessed like observers[componentID]
+        std::vector<Observers> observers;
+        // Set while NotifyObservers is calling observers, so new ones are held back until it's done
+        // and removed ones are only emptied
+        bool notifying;
+        ObserverID nextObserverID;
+
+        ObserverID AddObserver(std::vector<RegisteredObserver>& list, ComponentObserver observer)
+        {
+            list.push_back({ nextObserverID, std::move(observer) });
+            return nextObserverID++;
+        }
 
-        // Makes a new entity and returns its id
-        int RegisterNewEntity();
+        // componentID's observers. The first time one is added, the pool starts counting events from now
+        template <class ComponentType>
+        Observers& ObserversFor();
+
+        // Queues entity for its OnRemove observers before it loses the component in pool. Entities
+        // that only got the component since the last flush were never reported added, so they're skipped
+        template <class Pool>
+        void RecordRemoval(const Pool& pool, Entity entity);
+
+        // Hands every observer the events gathered since the last flush, removals first
+        void NotifyObservers();
+
+        // Handle for the entity currently living in slot index
+        Entity HandleAt(uint32_t index) const { return Entity::Make(index, generations[index]); }
+
+    public:
+        EntityManager();
+        ~EntityManager();
+
+        // Makes a new entity and returns its handle, or INVALID_ENTITY if there is no room left
+        Entity RegisterNewEntity();
         // Clears out an entity's space
-        void DeregisterEntity(int id);
+        void DeregisterEntity(Entity entity);
+
+        // Returns the handle of an entity that will exist after the next FlushCommands, or
+        // INVALID_ENTITY if there is no room left. Safe to call from any number of threads at once,
+        // and never takes a lock, but not while anything else makes structural changes. Until the
+        // flush, only use the handle in command buffers, to stage the entity's components
+        Entity ReserveEntity();
 
         // Clears out all entities
         void DeregisterAllEntities();
 
-        // Adds component of type ComponentType to the entity.
+        // Makes count entities that each get a copy of prefab's components and returns their handles.
+        // Slots, pool chunks and cached query updates are done once for the whole batch rather than
+        // per entity. Fewer than count are made if the entity limit is reached
+        template <class... ComponentTypes>
+        std::vector<Entity> Instantiate(const Prefab<ComponentTypes...>& prefab, int count);
+
+        // Moves every entity into target, leaving this manager empty, and returns their new handles,
+        // accessed like moved[oldEntity.Index()]. Components are moved in bulk and count as added at
+        // target's tick. Flush this manager's commands first, they aren't carried over. Entities that
+        // don't fit in target are dropped and get INVALID_ENTITY. Each Parent is rewritten to its
+        // parent's new handle, or INVALID_ENTITY if the parent didn't move
+        std::vector<Entity> MergeInto(EntityManager& target);
+
+        // Clears out every entity in entities that is still alive, visiting each pool once for the batch
+        void DeregisterEntities(const std::vector<Entity>& entities);
+
+        // Clears out every entity that has all of the given components and none of the Without<...> ones
+        template <class... ComponentTypes, class... ExcludedTypes>
+        void DeregisterEntitiesWith(Without<ExcludedTypes...> = {});
+
+        // The calling thread's command buffer. Record structural changes here while systems
+        // are running, they're applied on the next FlushCommands
+        CommandBuffer& GetCommandBuffer();
+
+        // Makes reserved entities real, then applies and clears every thread's command buffer,
+        // then calls the component observers. Call it at a sync point, when no thread is recording
+        // and no view is being iterated
+        void FlushCommands();
+
+        // Calls observer once per FlushCommands with every entity that got a ComponentType since the
+        // last flush and still has it, however it was added. Entities are batched per flush so
+        // observers can update their own structures in one go instead of once per entity. An entity
+        // that got and lost the component between two flushes isn't reported to OnAdd or OnRemove.
+        // Observers stay registered until they're passed to RemoveObserver, and are free to make
+        // changes, those are reported on the next flush. Observers registered by an observer start
+        // getting called on the next flush too. Observed pools are read from their change logs, so
+        // flush at least once every CHANGE_LOG_TICKS ticks or the oldest events are lost
+        template <class ComponentType>
+        ObserverID OnAdd(ComponentObserver observer);
+
+        // Like OnAdd, for entities that lost a ComponentType since the last flush, including by being
+        // deregistered. The handles are the ones the entities had, so they may no longer be alive
+        template <class ComponentType>
+        ObserverID OnRemove(ComponentObserver observer);
+
+        // Like OnAdd, for entities whose ComponentType was marked changed since the last flush.
+        // Entities also reported to OnAdd in the same flush are left out. Tags never change
+        template <class ComponentType>
+        ObserverID OnChange(ComponentObserver observer);
+
+        // Unregisters an observer, it isn't called again, even later in a flush that's under way.
+        // Anything an observer captures has to outlive the EntityManager or be removed first
+        void RemoveObserver(ObserverID id);
+
+        // The tick changes are currently stamped with
+        uint32_t GetTick() const { return tick; }
+
+        // Moves on to the next tick, and forgets changes older than CHANGE_LOG_TICKS ticks
+        void AdvanceTick();
+
+        // True if entity hasn't been deregistered since its handle was made. Reserved entities
+        // aren't alive until the flush that makes them, even when their slot's generation matches
+        bool IsAlive(Entity entity) const
+        {
+            uint32_t index = entity.Index();
+            return index < generations.size() && generations[index] == entity.Generation() && alive[index];
+        }
+
+        int GetEntityCount() const { return entityCount; }
+
+        // Memory use of the slot arrays and every pool, and the state of every cached query
+        EntityManagerStats GetStats();
+
+        // Entity slots are indexed [0, GetSlotCount()). Use GetEntity to see if a slot is in use
+        int GetSlotCount() const { return (int)generations.size(); }
+
+        // Returns the entity living in slot index, or INVALID_ENTITY if the slot is empty
+        Entity GetEntity(int index) const;
+
+        // Copies component into the entity's slot of the ComponentType pool.
+        // Returns the stored component, or nullptr if nothing was added
         template <class ComponentType>
-        void AddComponent(int id, ComponentType* component);
+        ComponentType* AddComponent(Entity entity, const ComponentType& component);
 
-        // Adds a component by id
-        void AddComponent(int componentID, int entityID, Component* component);
+        // Removes component of type ComponentType from the given entity
+        template <class ComponentType>
+        void RemoveComponent(Entity entity);
 
-        // Removes component of type ComponentType from the entity with the given entityID
+        // Returns nullptr if the entity doesn't have the component or is no longer alive
         template <class ComponentType>
-        void RemoveComponent(int entityID);
+        ComponentType* GetComponent(Entity entity);
 
+        // Like GetComponent, but marks the component changed since the caller is going to write it
         template <class ComponentType>
-        ComponentType* GetComponent(int entityID);
+        ComponentType* GetComponentForWrite(Entity entity);
 
-        template <class... ComponentTypes>
-        std::vector<int> GetEntitiesWithComponents();
+        // Stamps the entity's ComponentType with the current tick, for Changed queries
+        template <class ComponentType>
+        void MarkChanged(Entity entity);
 
         template <class ComponentType>
-        std::vector<Component*> GetAllComponentsOfType() { return components[ComponentType::id]; }
+        bool HasComponent(Entity entity);
+
+        // Lazy, allocation free query over every entity that has all of the given components,
+        // and none of the Without<...> ones if given
+        template <class... ComponentTypes, class... ExcludedTypes>
+        View<ComponentTypes...> GetView(Without<ExcludedTypes...> = {});
+
+        // Like GetView, but only walks the entities whose ChangedType was added or marked changed
+        // at filter.since or later. If that's older than the CHANGE_LOG_TICKS the log keeps, every
+        // entity in the ChangedType pool is visited instead
+        template <class... ComponentTypes, class ChangedType, class... ExcludedTypes>
+        View<ComponentTypes...> GetView(Changed<ChangedType> filter, Without<ExcludedTypes...> = {});
+
+        // Like GetView, but only walks the entities whose AddedType was added at filter.since or later
+        template <class... ComponentTypes, class AddedType, class... ExcludedTypes>
+        View<ComponentTypes...> GetView(Added<AddedType> filter, Without<ExcludedTypes...> = {});
+
+        // Like GetView, but walks a cached entity list that is updated as components are added
+        // and removed instead of being joined every time. Use it for queries made every frame.
+        template <class... ComponentTypes, class... ExcludedTypes>
+        View<ComponentTypes...> GetCachedView(Without<ExcludedTypes...> = {});
+
+        // Reorders the cached query GetCachedView<ComponentTypes...>(Without<...>) walks, so its views
+        // visit entities in order of key(components...). key returns anything comparable with <, like
+        // a std::tie of the fields to group by. Cheap when only a few entities changed since the last
+        // sort. Don't call it while the same cached view is being iterated
+        template <class... ComponentTypes, class KeyFunc, class... ExcludedTypes>
+        void SortCachedView(KeyFunc key, Without<ExcludedTypes...> = {});
+        // Like SortCachedView, but by key(entityIndex), for keys kept outside the components
+        template <class... ComponentTypes, class KeyFunc, class... ExcludedTypes>
+        void SortCachedViewByIndex(KeyFunc key, Without<ExcludedTypes...> = {});
+        // How many times an entity has joined or left that cached query. Joins and leaves put a
+        // sorted query out of order, so while this and the keys stay the same it needs no sort
+        template <class... ComponentTypes, class... ExcludedTypes>
+        int64_t GetCachedViewUpdates(Without<ExcludedTypes...> = {});
+
+        // Reorders ComponentType's pool so views walking it visit components in order of
+        // less(componentA, componentB). Cheap when only a few components changed since the last sort.
+        // A structural change, so not while any view over the pool is being iterated
+        template <class ComponentType, class Less>
+        void SortComponents(Less less);
+
+        // Copies every entity that has all of the given components, and none of the Without<...>
+        // ones if given, into a new vector. Prefer GetView when the result is only iterated
+        template <class... ComponentTypes, class... ExcludedTypes>
+        std::vector<Entity> GetEntitiesWithComponents(Without<ExcludedTypes...> = {});
+
+        // Calls func(entity, ComponentTypes&...) for every entity in GetView<ComponentTypes...>()
+        template <class... ComponentTypes, class Func>
+        void ForEach(Func func);
+
+        // Like ForEach, but splits the entities into batches run on the JobSystem and returns once
+        // all of them are done. Batches are whole chunks of the pool the view walks, the smallest
+        // one, so two threads never write that pool's components on the same cache line. The other
+        // pools' components are looked up per entity and their chunks can straddle batches.
+        // func is called from several threads at once. It must not make structural changes, and must
+        // not call MarkChanged or GetComponentForWrite either: those append to the pool's change log,
+        // which isn't thread safe. Gather what changed and mark it once ParallelForEach returns
+        template <class... ComponentTypes, class Func, class... ExcludedTypes>
+        void ParallelForEach(Func func, Without<ExcludedTypes...> = {});
+
+        // Calls func(entity) for every entity that has all of TagTypes, testing 64 entities at a time
+        template <class... TagTypes, class Func>
+        void ForEachTagged(Func func);
 
         template <class ComponentType>
-        static void RegisterNewComponentType();
+        PoolFor<ComponentType>& GetComponentPool();
 
-        bool EntityHasComponent(int componentID, int entityID);
+        bool EntityHasComponent(int componentID, Entity entity);
     };
 
     template<class ComponentType>
-    inline void EntityManager::AddComponent(int id, ComponentType* component)
+    inline EntityManager::Observers& EntityManager::ObserversFor()
     {
-        AddComponent(ComponentType::id, id, component);
+        Observers& watchers = observers[ComponentID<ComponentType>];
+        if (watchers.Empty() && !watchers.AnyPending()) GetComponentPool<ComponentType>().ResetEvents();
+        return watchers;
     }
+
+    template<class Pool>
+    inline void EntityManager::RecordRemoval(const Pool& pool, Entity entity)
+    {
+        Observers& watchers = observers[ComponentID<typename Pool::Type>];
+        bool watched = !watchers.onRemove.empty() || !watchers.pendingOnRemove.empty();
+        if (watched && !pool.AddedSinceEvents(entity.Index())) watchers.removed.push_back(entity);
+    }
+
     template<class ComponentType>
-    inline void EntityManager::RemoveComponent(int entityID)
+    inline ObserverID EntityManager::OnAdd(ComponentObserver observer)
     {
-        int componentID = ComponentType::id;
-        // There's not a component here
-        if (components[componentID][entityID]->ID() == INVALID_COMPONENT) return;
-        // Set to an empty component, will have an ID of INVALID_COMPONENT which is useful
-        if (components[componentID][entityID]->ID() != MESH_ID) delete components[componentID][entityID];
-        components[componentID][entityID] = new Component();
+        Observers& watchers = ObserversFor<ComponentType>();
+        return AddObserver(notifying ? watchers.pendingOnAdd : watchers.onAdd, std::move(observer));
+    }
 
-        auto& entitiesVec = componentEntityIDs[componentID];
-        auto it = std::find(entitiesVec.begin(), entitiesVec.end(), entityID);
-        if (it != entitiesVec.end())
-            entitiesVec.erase(it);
+    template<class ComponentType>
+    inline ObserverID EntityManager::OnRemove(ComponentObserver observer)
+    {
+        Observers& watchers = ObserversFor<ComponentType>();
+        return AddObserver(notifying ? watchers.pendingOnRemove : watchers.onRemove, std::move(observer));
     }
+
     template<class ComponentType>
-    inline ComponentType* EntityManager::GetComponent(int entityID)
+    inline ObserverID EntityManager::OnChange(ComponentObserver observer)
     {
-        int componentID = ComponentType::id;
-        return dynamic_cast<ComponentType*>(components[componentID][entityID]);
+        Observers& watchers = ObserversFor<ComponentType>();
+        return AddObserver(notifying ? watchers.pendingOnChange : watchers.onChange, std::move(observer));
     }
+
     template<class... ComponentTypes>
-    inline std::vector<int> EntityManager::GetEntitiesWithComponents()
+    inline std::vector<Entity> EntityManager::Instantiate(const Prefab<ComponentTypes...>& prefab, int count)
     {
-        std::vector<int> intersection;
-        std::tuple<ComponentTypes...> types;
-        int tupleSize = std::tuple_size<decltype(types)>::value;
-        // Need at least two types for an intersection
-        if (tupleSize < 2)
+        ECS_CHECK_STRUCTURAL_CHANGE();
+
+        std::vector<int> indices;
+        AllocateSlots(count, indices);
+
+        // New slots have no components, so every signature goes straight to the prefab's
+        for (int index : indices) signatures[index] = SignatureOf<ComponentTypes...>;
+        (GetComponentPool<ComponentTypes>().AddRange(indices, std::get<ComponentTypes>(prefab.components), tick), ...);
+        OnSignaturesChanged(SignatureOf<ComponentTypes...>, indices);
+
+        std::vector<Entity> spawned;
+        spawned.reserve(indices.size());
+        for (int index : indices) spawned.push_back(HandleAt(index));
+        return spawned;
+    }
+
+    template<class... ComponentTypes, class... ExcludedTypes>
+    inline void EntityManager::DeregisterEntitiesWith(Without<ExcludedTypes...>)
+    {
+        static_assert(sizeof...(ComponentTypes) > 0, "Use DeregisterAllEntities to clear out every entity");
+
+        std::vector<Entity> matches;
+        FindEntities(SignatureOf<ComponentTypes...>, Without<ExcludedTypes...>::signature, matches);
+        DeregisterEntities(matches);
+    }
+
+    template<class ComponentType>
+    inline ComponentType* EntityManager::AddComponent(Entity entity, const ComponentType& component)
+    {
+        ECS_CHECK_STRUCTURAL_CHANGE();
+        auto& pool = GetComponentPool<ComponentType>();
+        // Only add components to existing entities
+        if (!IsAlive(entity)) return nullptr;
+        // Don't allow double adding of components
+        if (pool.Has(entity.Index())) return nullptr;
+
+        ComponentType* added = pool.Add(entity.Index(), component, tick);
+        signatures[entity.Index()] |= SignatureOf<ComponentType>;
+        OnSignatureChanged(ComponentID<ComponentType>, entity.Index());
+        return added;
+    }
+    template<class ComponentType>
+    inline void EntityManager::RemoveComponent(Entity entity)
+    {
+        ECS_CHECK_STRUCTURAL_CHANGE();
+        if (!HasComponent<ComponentType>(entity)) return;
+        signatures[entity.Index()] &= ~SignatureOf<ComponentType>;
+        OnSignatureChanged(ComponentID<ComponentType>, entity.Index());
+        auto& pool = GetComponentPool<ComponentType>();
+        RecordRemoval(pool, entity);
+        pool.Remove(entity.Index());
+    }
+    template<class ComponentType>
+    inline ComponentType* EntityManager::GetComponent(Entity entity)
+    {
+        if (!IsAlive(entity)) return nullptr;
+        return GetComponentPool<ComponentType>().Get(entity.Index());
+    }
+    template<class ComponentType>
+    inline ComponentType* EntityManager::GetComponentForWrite(Entity entity)
+    {
+        MarkChanged<ComponentType>(entity);
+        return GetComponent<ComponentType>(entity);
+    }
+    template<class ComponentType>
+    inline void EntityManager::MarkChanged(Entity entity)
+    {
+        ECS_CHECK_ACCESS(SignatureOf<ComponentType>, true);
+        if (!IsAlive(entity)) return;
+        GetComponentPool<ComponentType>().MarkChanged(entity.Index(), tick);
+    }
+    template<class ComponentType>
+    inline bool EntityManager::HasComponent(Entity entity)
+    {
+        return IsAlive(entity) && (signatures[entity.Index()] & SignatureOf<ComponentType>) != 0;
+    }
+    template<class... ComponentTypes, class... ExcludedTypes>
+    inline View<ComponentTypes...> EntityManager::GetView(Without<ExcludedTypes...>)
+    {
+        return View<ComponentTypes...>(&generations, &signatures, Without<ExcludedTypes...>::signature,
+            nullptr, 0, &GetComponentPool<ComponentTypes>()...);
+    }
+
+    template<class... ComponentTypes, class ChangedType, class... ExcludedTypes>
+    inline View<ComponentTypes...> EntityManager::GetView(Changed<ChangedType> filter, Without<ExcludedTypes...>)
+    {
+        auto& pool = GetComponentPool<ChangedType>();
+        const ChangeLog& log = pool.Changes();
+        int first = log.FirstSince(filter.since);
+
+        // The log doesn't go back that far, anything could have changed
+        if (first == INVALID_INDEX)
         {
-            // Get all entities with the component passed in, if one was passed in
-            if (tupleSize == 1 && componentEntityIDs[std::get<0>(types).ID()].size() > 0)
+            return View<ComponentTypes...>(&generations, &signatures, Without<ExcludedTypes...>::signature,
+                &pool.Entities(), 0, &GetComponentPool<ComponentTypes>()...);
+        }
+        return View<ComponentTypes...>(&generations, &signatures, Without<ExcludedTypes...>::signature,
+            &log.Entities(), first, &GetComponentPool<ComponentTypes>()...);
+    }
+
+    template<class... ComponentTypes, class AddedType, class... ExcludedTypes>
+    inline View<ComponentTypes...> EntityManager::GetView(Added<AddedType> filter, Without<ExcludedTypes...>)
+    {
+        auto& pool = GetComponentPool<AddedType>();
+        const ChangeLog& log = pool.Additions();
+        int first = log.FirstSince(filter.since);
+
+        if (first == INVALID_INDEX)
+        {
+            return View<ComponentTypes...>(&generations, &signatures, Without<ExcludedTypes...>::signature,
+                &pool.Entities(), 0, &GetComponentPool<ComponentTypes>()...);
+        }
+        return View<ComponentTypes...>(&generations, &signatures, Without<ExcludedTypes...>::signature,
+            &log.Entities(), first, &GetComponentPool<ComponentTypes>()...);
+    }
+
+    template<class... ComponentTypes, class... ExcludedTypes>
+    inline CachedQuery& EntityManager::GetCachedQuery(Without<ExcludedTypes...> without)
+    {
+        // One id per component list and exclusion list, shared by every EntityManager
+        static const int queryID = numQueryTypes++;
+
+        std::lock_guard<std::mutex> lock(cachedQueriesMutex);
+        if (queryID >= (int)cachedQueries.size()) cachedQueries.resize(queryID + 1);
+        auto& query = cachedQueries[queryID];
+        if (!query)
+        {
+            // First use: fill the query from scratch, from here on it's kept up to date
+            auto buildStart = std::chrono::high_resolution_clock::now();
+            query = std::make_unique<CachedQuery>(SignatureOf<ComponentTypes...>, without.signature);
+            for (int componentID = 0; componentID < NUM_COMPONENT_TYPES; componentID++)
             {
-                return componentEntityIDs[std::get<0>(types).ID()];
+                if (((query->Required() | query->Excluded()) >> componentID) & 1)
+                {
+                    queriesByComponent[componentID].push_back(query.get());
+                }
             }
-            // If none were passed in, return an empty vector
-            else
+            for (auto match : GetView<ComponentTypes...>(without))
             {
-                return intersection;
+                query->Insert(std::get<0>(match).Index());
             }
+            query->SetBuildMilliseconds(std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - buildStart).count());
         }
 
-        // Get vectors for entity id's of each component type
-        vectorsToIntersect.clear();
-        boost::mp11::tuple_for_each(types, [&](const auto& type) {
-            // Cast the type to a component
-            Component* comp = static_cast<Component*>((void*)(&type));
-            // Make sure the component is valid, then push entity id
-            // vector for that component to the vectorsToIntersect vector
-            int id = comp->ID();
-            assert(id != INVALID_COMPONENT); // Type MUST be a component
-            vectorsToIntersect.push_back(&componentEntityIDs[id]);
+        return *query;
+    }
+
+    template<class... ComponentTypes, class... ExcludedTypes>
+    inline View<ComponentTypes...> EntityManager::GetCachedView(Without<ExcludedTypes...> without)
+    {
+        CachedQuery& query = GetCachedQuery<ComponentTypes...>(without);
+        return View<ComponentTypes...>(&generations, &signatures, without.signature,
+            &query.Entities(), 0, &GetComponentPool<ComponentTypes>()...);
+    }
+
+    template<class... ComponentTypes, class KeyFunc, class... ExcludedTypes>
+    inline void EntityManager::SortCachedView(KeyFunc key, Without<ExcludedTypes...> without)
+    {
+        CachedQuery& query = GetCachedQuery<ComponentTypes...>(without);
+        std::tuple<PoolFor<ComponentTypes>*...> pools(&GetComponentPool<ComponentTypes>()...);
+        query.Sort([&](int a, int b) {
+            return key(*std::get<PoolFor<ComponentTypes>*>(pools)->Get(a)...) < key(*std::get<PoolFor<ComponentTypes>*>(pools)->Get(b)...);
         });
+    }
+
+    template<class... ComponentTypes, class KeyFunc, class... ExcludedTypes>
+    inline void EntityManager::SortCachedViewByIndex(KeyFunc key, Without<ExcludedTypes...> without)
+    {
+        GetCachedQuery<ComponentTypes...>(without).Sort([&](int a, int b) { return key((uint32_t)a) < key((uint32_t)b); });
+    }
+
+    template<class... ComponentTypes, class... ExcludedTypes>
+    inline int64_t EntityManager::GetCachedViewUpdates(Without<ExcludedTypes...> without)
+    {
+        return GetCachedQuery<ComponentTypes...>(without).Updates();
+    }
+
+    template<class ComponentType, class Less>
+    inline void EntityManager::SortComponents(Less less)
+    {
+        static_assert(!IsTag<ComponentType>, "Tags have no order to sort by");
+        ECS_CHECK_STRUCTURAL_CHANGE();
+        GetComponentPool<ComponentType>().Sort(less);
+    }
+
+    template<class... ComponentTypes, class... ExcludedTypes>
+    inline std::vector<Entity> EntityManager::GetEntitiesWithComponents(Without<ExcludedTypes...>)
+    {
+        static_assert(sizeof...(ComponentTypes) > 0, "Empty slots have no components, so at least one type is required");
+
+        std::vector<Entity> entitiesWithComponents;
+        FindEntities(SignatureOf<ComponentTypes...>, Without<ExcludedTypes...>::signature, entitiesWithComponents);
+        return entitiesWithComponents;
+    }
+
+    template<class... ComponentTypes, class Func>
+    inline void EntityManager::ForEach(Func func)
+    {
+        for (auto match : GetView<ComponentTypes...>())
+        {
+            std::apply(func, match);
+        }
+    }
 
-        // Intersect the vectors. We only want the entity id's
-        // for entities with ALL of the passed in components.
-        std::vector<int> prevVec = *vectorsToIntersect[0];
-        for (int i = 1; i < vectorsToIntersect.size(); i++)
+    template<class... ComponentTypes, class Func, class... ExcludedTypes>
+    inline void EntityManager::ParallelForEach(Func func, Without<ExcludedTypes...> without)
+    {
+        View<ComponentTypes...> view = GetView<ComponentTypes...>(without);
+        int count = view.SizeHint();
+
+        // Aim for a few batches per worker so they can even out, but never split a chunk
+        JobSystem& jobSystem = JobSystem::GetInstance();
+        int chunkCount = (count + COMPONENT_CHUNK_SIZE - 1) / COMPONENT_CHUNK_SIZE;
+        int chunksPerBatch = (std::max)(1, chunkCount / (jobSystem.GetWorkerCount() * 4));
+        int batchSize = chunksPerBatch * COMPONENT_CHUNK_SIZE;
+
+        JobCounter counter;
+        for (int from = 0; from < count; from += batchSize)
         {
-            std::vector<int>& nextVec = *vectorsToIntersect[i];
-            boost::set_intersection(prevVec, nextVec, std::back_inserter(intersection));
-            prevVec = intersection;
-            intersection.clear();
+            jobSystem.Run([&view, &func, from, batchSize]() {
+                for (auto match : view.Slice(from, from + batchSize))
+                {
+                    std::apply(func, match);
+                }
+            }, &counter);
         }
-        
+        jobSystem.Wait(counter);
+    }
 
-        return prevVec;
+    template<class... TagTypes, class Func>
+    inline void EntityManager::ForEachTagged(Func func)
+    {
+        static_assert((IsTag<TagTypes> && ...), "ForEachTagged only takes tags, use GetView for components with data");
+
+        const std::vector<uint64_t>* bitsets[] = { &GetComponentPool<TagTypes>().Words()... };
+
+        // Past the end of the shortest bitset no entity can have every tag
+        int wordCount = (std::min)({ (int)GetComponentPool<TagTypes>().Words().size()... });
+        for (int w = 0; w < wordCount; w++)
+        {
+            uint64_t bits = ~uint64_t(0);
+            for (auto bitset : bitsets) bits &= (*bitset)[w];
+
+            for (; bits != 0; bits &= bits - 1)
+            {
+                func(HandleAt(w * 64 + CountTrailingZeros(bits)));
+            }
+        }
     }
 
-    template <class ComponentType>
-    static inline void EntityManager::RegisterNewComponentType()
+    template<class ComponentType>
+    inline PoolFor<ComponentType>& EntityManager::GetComponentPool()
     {
-        ComponentType::id = numComponentTypes++;
+        static_assert(ComponentID<ComponentType> < NUM_COMPONENT_TYPES, "Component types must be listed in ComponentList");
+        ECS_CHECK_ACCESS(SignatureOf<ComponentType>, false);
+        return std::get<ComponentID<ComponentType>>(componentPools);
     }
 }
\ No newline at end of file
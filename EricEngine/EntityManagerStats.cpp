@@ -0,0 +1,78 @@
+#include "EntityManagerStats.h"
+
+#include <sstream>
+
+// Writes text as a quoted JSON string, escaping what JSON doesn't allow raw
+static void WriteJsonString(std::ostringstream& json, const char* text)
+{
+    static const char hexDigits[] = "0123456789abcdef";
+    json << '"';
+    for (const char* c = text; *c != '\0'; c++)
+    {
+        unsigned char character = (unsigned char)*c;
+        switch (character)
+        {
+        case '"': json << "\\\""; break;
+        case '\\': json << "\\\\"; break;
+        case '\n': json << "\\n"; break;
+        case '\r': json << "\\r"; break;
+        case '\t': json << "\\t"; break;
+        default:
+            // Other control characters only fit as \u escapes
+            if (character < 0x20) json << "\\u00" << hexDigits[character >> 4] << hexDigits[character & 15];
+            else json << *c;
+        }
+    }
+    json << '"';
+}
+
+size_t ECS::EntityManagerStats::TotalBytesReserved() const
+{
+    size_t total = slotBytes;
+    for (const PoolStats& pool : pools) total += pool.bytesReserved;
+    return total;
+}
+
+std::string ECS::EntityManagerStats::ToJson() const
+{
+    std::ostringstream json;
+    json << "{\"entityCount\":" << entityCount
+        << ",\"slotCount\":" << slotCount
+        << ",\"freeSlots\":" << freeSlots
+        << ",\"slotBytes\":" << slotBytes
+        << ",\"totalBytesReserved\":" << TotalBytesReserved()
+        << ",\"pools\":[";
+
+    for (size_t i = 0; i < pools.size(); i++)
+    {
+        const PoolStats& pool = pools[i];
+        if (i > 0) json << ",";
+        json << "{\"name\":";
+        WriteJsonString(json, pool.name);
+        json << ",\"componentID\":" << pool.componentID
+            << ",\"tag\":" << (pool.tag ? "true" : "false")
+            << ",\"count\":" << pool.count
+            << ",\"capacity\":" << pool.capacity
+            << ",\"bytesUsed\":" << pool.bytesUsed
+            << ",\"bytesReserved\":" << pool.bytesReserved
+            << ",\"fragmentation\":" << pool.fragmentation
+            << ",\"allocations\":" << pool.allocations << "}";
+    }
+
+    json << "],\"queries\":[";
+    for (size_t i = 0; i < queries.size(); i++)
+    {
+        const QueryStats& query = queries[i];
+        if (i > 0) json << ",";
+        json << "{\"required\":" << query.required
+            << ",\"excluded\":" << query.excluded
+            << ",\"matches\":" << query.matches
+            << ",\"buildMilliseconds\":" << query.buildMilliseconds
+            << ",\"updates\":" << query.updates
+            << ",\"updateMilliseconds\":" << query.updateMilliseconds
+            << ",\"lastTickUpdateMilliseconds\":" << query.lastTickUpdateMilliseconds << "}";
+    }
+    json << "]}";
+
+    return json.str();
+}
\ No newline at end of file
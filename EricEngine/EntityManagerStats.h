@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include "Components.h"
+
+namespace ECS
+{
+    // Memory use of one component type's pool
+    struct PoolStats
+    {
+        const char* name;
+        int componentID;
+        // Tags are stored as a bit per entity rather than in chunks
+        bool tag;
+        // Components stored, and how many fit before the pool has to allocate again
+        int count;
+        int capacity;
+        // Bytes holding live components and their bookkeeping, and bytes allocated in all
+        size_t bytesUsed;
+        size_t bytesReserved;
+        // Share of the reserved bytes not in use, from 0 to 1
+        float fragmentation;
+        // Blocks the pool has allocated over its lifetime: chunks and sparse pages, or bitset growths for tags
+        int allocations;
+    };
+
+    // One cached query made by GetCachedView
+    struct QueryStats
+    {
+        Signature required;
+        Signature excluded;
+        int matches;
+        // How long filling the query from scratch took when it was first used
+        double buildMilliseconds;
+        // Entities that joined or left the query, counting the first fill
+        int64_t updates;
+        // Time spent on those joins and leaves after the first fill, in all and during the last whole tick
+        double updateMilliseconds;
+        double lastTickUpdateMilliseconds;
+    };
+
+    // A snapshot of an EntityManager's memory use and cached queries, from EntityManager::GetStats
+    struct EntityManagerStats
+    {
+        int entityCount;
+        int slotCount;
+        int freeSlots;
+        // Bytes allocated for the per slot arrays: generations, alive flags, signatures and free list
+        size_t slotBytes;
+        std::vector<PoolStats> pools;
+        std::vector<QueryStats> queries;
+
+        // Slot arrays plus every pool
+        size_t TotalBytesReserved() const;
+
+        // The whole snapshot as a JSON object, for tools and benchmark logs
+        std::string ToJson() const;
+    };
+}
\ No newline at end of file
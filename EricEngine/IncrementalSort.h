@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+// Sorts with at most this many entries out of place fix them up with insertion sort, which
+// touches little more than the moved entries. With more than that they sort from scratch
+#define INCREMENTAL_SORT_LIMIT 32
+
+namespace ECS
+{
+    // Sorts order by less, cheaply if only a few entries moved out of place since it was last sorted.
+    // Returns false if order was already sorted
+    template <class T, class Less>
+    bool IncrementalSort(std::vector<T>& order, Less less)
+    {
+        int unsorted = 0;
+        for (int i = 1; i < (int)order.size(); i++)
+        {
+            if (less(order[i], order[i - 1])) unsorted++;
+        }
+        if (unsorted == 0) return false;
+
+        if (unsorted > INCREMENTAL_SORT_LIMIT)
+        {
+            std::sort(order.begin(), order.end(), less);
+            return true;
+        }
+
+        for (int i = 1; i < (int)order.size(); i++)
+        {
+            T moving = order[i];
+            int j = i;
+            for (; j > 0 && less(moving, order[j - 1]); j--) order[j] = order[j - 1];
+            order[j] = moving;
+        }
+        return true;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+struct Job;
+
+// A fixed size Chase-Lev work-stealing deque. The worker that owns it pushes and pops
+// jobs at the bottom without locking, any other worker can steal from the top.
+class JobQueue
+{
+public:
+    // capacity has to be a power of two
+    JobQueue(int capacity) : jobs(new std::atomic<Job*>[capacity]), mask(capacity - 1), top(0), bottom(0) {}
+
+    // Owner only. Returns false if the queue is full
+    bool Push(Job* job)
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        if (b - t > mask) return false;
+
+        // Release so a thief that sees the new bottom also sees the job
+        jobs[b & mask].store(job, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Owner only. Takes the newest job, or nullptr if there is none
+    Job* Pop()
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+
+        if (t > b)
+        {
+            // Empty
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        Job* job = jobs[b & mask].load(std::memory_order_relaxed);
+        if (t == b)
+        {
+            // Last job, race any thieves for it
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) job = nullptr;
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    // Any thread. Takes the oldest job, or nullptr if there is none or another thread got it first
+    Job* Steal()
+    {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) return nullptr;
+
+        Job* job = jobs[t & mask].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return nullptr;
+        return job;
+    }
+
+private:
+    std::unique_ptr<std::atomic<Job*>[]> jobs;
+    int64_t mask;
+    // Thieves take from top, the owner works at bottom. Kept on separate cache lines
+    alignas(64) std::atomic<int64_t> top;
+    alignas(64) std::atomic<int64_t> bottom;
+};
\ No newline at end of file
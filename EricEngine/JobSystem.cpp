@@ -0,0 +1,221 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+JobSystem* JobSystem::instance;
+
+// Which worker the calling thread is, -1 for threads that aren't workers
+static thread_local int workerIndex = -1;
+// Decides which worker to try stealing from first
+static thread_local uint32_t stealSeed = 0x9E3779B9;
+
+JobSystem& JobSystem::GetInstance()
+{
+    if (!instance) instance = new JobSystem();
+    return *instance;
+}
+
+JobSystem& JobSystem::Initialize(int workerCount)
+{
+    if (!instance) instance = new JobSystem(workerCount);
+    return *instance;
+}
+
+JobSystem::JobSystem(int workerCount)
+{
+    quitting = false;
+    sleepingWorkers = 0;
+    externalJobCount = 0;
+
+    if (workerCount < 0) workerCount = (std::max)(1, (int)std::thread::hardware_concurrency()) - 1;
+
+    // The calling thread is worker 0
+    int totalWorkers = workerCount + 1;
+    for (int i = 0; i < totalWorkers; i++)
+    {
+        queues.push_back(std::make_unique<JobQueue>(JOB_QUEUE_CAPACITY));
+        jobRings.push_back(std::make_unique<Job[]>(JOB_QUEUE_CAPACITY));
+        nextJob.push_back(0);
+    }
+
+    workerIndex = 0;
+    for (int i = 1; i < totalWorkers; i++)
+    {
+        threads.emplace_back(&JobSystem::WorkerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        quitting = true;
+    }
+    jobSubmitted.notify_all();
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    if (instance == this) instance = nullptr;
+}
+
+Job* JobSystem::AllocateJob()
+{
+    // Workers reuse jobs from their own ring. If the ring has wrapped around onto a job that
+    // is still queued, or the caller isn't a worker, fall back to the heap
+    if (workerIndex >= 0)
+    {
+        Job* job = &jobRings[workerIndex][nextJob[workerIndex]++ & (JOB_QUEUE_CAPACITY - 1)];
+        if (!job->inUse.load(std::memory_order_acquire))
+        {
+            job->inUse.store(true, std::memory_order_relaxed);
+            job->heapAllocated = false;
+            return job;
+        }
+    }
+
+    Job* job = new Job();
+    job->heapAllocated = true;
+    return job;
+}
+
+void JobSystem::Submit(Job* job)
+{
+    if (workerIndex >= 0)
+    {
+        // Our queue is full, better to do the work now than to drop it
+        if (!queues[workerIndex]->Push(job))
+        {
+            Execute(job);
+            return;
+        }
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(externalJobsMutex);
+        externalJobs.push_back(job);
+        externalJobCount++;
+    }
+
+    // Wake a sleeping worker. The fence pairs with the one a worker makes before its last
+    // look for jobs, so either it sees this job or we see it going to sleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepingWorkers.load(std::memory_order_relaxed) > 0)
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        jobSubmitted.notify_one();
+    }
+}
+
+Job* JobSystem::FindJob()
+{
+    if (workerIndex >= 0)
+    {
+        if (Job* job = queues[workerIndex]->Pop()) return job;
+    }
+
+    if (externalJobCount.load(std::memory_order_relaxed) > 0)
+    {
+        std::lock_guard<std::mutex> lock(externalJobsMutex);
+        if (!externalJobs.empty())
+        {
+            Job* job = externalJobs.front();
+            externalJobs.pop_front();
+            externalJobCount--;
+            return job;
+        }
+    }
+
+    // Steal, starting from a random worker so thieves don't all pile onto the same one
+    stealSeed ^= stealSeed << 13;
+    stealSeed ^= stealSeed >> 17;
+    stealSeed ^= stealSeed << 5;
+    int workerCount = (int)queues.size();
+    int first = (int)(stealSeed % workerCount);
+    for (int i = 0; i < workerCount; i++)
+    {
+        int victim = (first + i) % workerCount;
+        if (victim == workerIndex) continue;
+        if (Job* job = queues[victim]->Steal()) return job;
+    }
+
+    return nullptr;
+}
+
+void JobSystem::Execute(Job* job)
+{
+    job->invoke(*job);
+
+    JobCounter* counter = job->counter;
+    if (job->heapAllocated) delete job;
+    else job->inUse.store(false, std::memory_order_release);
+
+    if (counter != nullptr) Finish(counter);
+}
+
+void JobSystem::Finish(JobCounter* counter)
+{
+    // Trade our job for a finishing mark, so the counter can't read as done, and be destroyed,
+    // while we might still be handing out its continuations
+    int previous = counter->pending.fetch_add(JOB_COUNTER_FINISHING - 1, std::memory_order_acq_rel);
+    if (previous % JOB_COUNTER_FINISHING == 1)
+    {
+        std::vector<Job*> ready;
+        {
+            std::lock_guard<std::mutex> lock(counter->continuationsMutex);
+            ready.swap(counter->continuations);
+        }
+        for (Job* job : ready) Submit(job);
+    }
+
+    // The last time this job touches the counter
+    counter->pending.fetch_sub(JOB_COUNTER_FINISHING, std::memory_order_release);
+}
+
+bool JobSystem::RunPendingJob()
+{
+    Job* job = FindJob();
+    if (job == nullptr) return false;
+
+    Execute(job);
+    return true;
+}
+
+void JobSystem::Wait(const JobCounter& counter)
+{
+    while (!counter.Done())
+    {
+        if (!RunPendingJob()) std::this_thread::yield();
+    }
+}
+
+void JobSystem::WorkerLoop(int index)
+{
+    workerIndex = index;
+    stealSeed = 0x9E3779B9u * (uint32_t)(index + 1);
+
+    while (!quitting.load(std::memory_order_relaxed))
+    {
+        if (RunPendingJob()) continue;
+
+        // Nothing to do. Say we're going to sleep, then look one last time before we do
+        Job* job = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleepingWorkers.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            // Submit notifies under sleepMutex once it sees us counted, and we hold the lock from
+            // counting ourselves until wait releases it, so its notify can't slip in before we wait
+            job = FindJob();
+            if (job == nullptr && !quitting.load(std::memory_order_relaxed))
+            {
+                jobSubmitted.wait(lock);
+            }
+            sleepingWorkers.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        if (job != nullptr) Execute(job);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include "JobQueue.h"
+
+// How many jobs each worker can have queued before new ones run right away instead
+#define JOB_QUEUE_CAPACITY 4096
+// Bytes a job's function object can take up without an extra allocation
+#define JOB_DATA_SIZE 64
+
+// Added to a counter's pending count by each job that is finishing, while it hands out continuations.
+// The job count lives in the bits below it
+#define JOB_COUNTER_FINISHING (1 << 20)
+
+struct Job;
+
+// Counts jobs that haven't finished yet. Pass one to JobSystem::Run for every job
+// in a group, then JobSystem::Wait on it to know the whole group is done, or queue
+// more work behind it with JobSystem::RunAfter
+class JobCounter
+{
+public:
+    // Once true, no job is touching the counter any more, so it's safe to destroy
+    bool Done() const { return pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+    std::atomic<int> pending{ 0 };
+
+    // Jobs from RunAfter, submitted by whichever job takes the count to zero
+    std::mutex continuationsMutex;
+    std::vector<Job*> continuations;
+};
+
+struct Job
+{
+    // Calls and then destroys the function object stored in data
+    void (*invoke)(Job& job);
+    JobCounter* counter;
+    // Jobs made on a worker come from its ring of jobs, others are allocated and deleted after running
+    bool heapAllocated;
+    std::atomic<bool> inUse{ false };
+    alignas(16) unsigned char data[JOB_DATA_SIZE];
+};
+
+// A pool of worker threads that share out jobs by work stealing. Each worker pushes and
+// pops its own jobs from a lock-free deque and steals from the others when it runs out.
+// The thread that first calls GetInstance counts as a worker too, but only runs jobs while
+// it waits on them.
+//
+// Anything can submit jobs: systems splitting up their entities, asset decoding, scene
+// loading. Waiting on a counter runs other jobs until the counter reaches zero, so waiting
+// from inside a job never blocks a worker.
+class JobSystem
+{
+public:
+    static JobSystem& GetInstance();
+
+    ~JobSystem();
+
+    // Queues func() to run on some worker. counter, if given, is counted up now and
+    // back down once func has run
+    template <class Func>
+    void Run(Func func, JobCounter* counter = nullptr);
+
+    // Queues func() to run once every job counted by dependency has run. Nothing waits for it,
+    // the last of those jobs submits it. dependency has to stay alive until then
+    template <class Func>
+    void RunAfter(JobCounter& dependency, Func func, JobCounter* counter = nullptr);
+
+    // Runs other jobs until counter reaches zero
+    void Wait(const JobCounter& counter);
+
+    // Runs one queued job on the calling thread if there is one. Returns false if nothing was run
+    bool RunPendingJob();
+
+    // Workers including the thread that made the job system
+    int GetWorkerCount() const { return (int)queues.size(); }
+
+    // Makes the job system with workerCount threads besides the calling one, instead of the
+    // default one per extra core. Call it before the first GetInstance, or after deleting the
+    // instance to start over with a different count
+    static JobSystem& Initialize(int workerCount);
+
+private:
+    static JobSystem* instance;
+
+    // Starts workerCount threads besides the calling one, by default one per extra core
+    JobSystem(int workerCount = -1);
+
+    // Accessed like queues[workerIndex]
+    std::vector<std::unique_ptr<JobQueue>> queues;
+    // Accessed like jobRings[workerIndex][i], jobs are handed out round robin
+    std::vector<std::unique_ptr<Job[]>> jobRings;
+    std::vector<uint32_t> nextJob;
+
+    std::vector<std::thread> threads;
+    std::atomic<bool> quitting;
+
+    // Jobs from threads that aren't workers
+    std::deque<Job*> externalJobs;
+    std::mutex externalJobsMutex;
+    // So workers can skip the lock while there are none
+    std::atomic<int> externalJobCount;
+
+    // Idle workers sleep here until a job is submitted
+    std::mutex sleepMutex;
+    std::condition_variable jobSubmitted;
+    std::atomic<int> sleepingWorkers;
+
+    Job* AllocateJob();
+    // A job that calls func, counted by counter, ready to Submit
+    template <class Func>
+    Job* MakeJob(Func func, JobCounter* counter);
+    void Submit(Job* job);
+    // Counts a job on counter as done, and submits the counter's continuations if it was the last
+    void Finish(JobCounter* counter);
+    // Finds a job to run: our own newest, then anything from other threads
+    Job* FindJob();
+    void Execute(Job* job);
+    void WorkerLoop(int workerIndex);
+};
+
+template<class Func>
+inline Job* JobSystem::MakeJob(Func func, JobCounter* counter)
+{
+    static_assert(sizeof(Func) <= JOB_DATA_SIZE, "Job captures too much, capture pointers instead");
+    static_assert(alignof(Func) <= 16, "Job function object is over aligned");
+
+    Job* job = AllocateJob();
+    new (job->data) Func(std::move(func));
+    job->invoke = [](Job& job) {
+        Func* f = std::launder(reinterpret_cast<Func*>(job.data));
+        (*f)();
+        f->~Func();
+    };
+    job->counter = counter;
+    if (counter != nullptr) counter->pending.fetch_add(1, std::memory_order_relaxed);
+    return job;
+}
+
+template<class Func>
+inline void JobSystem::Run(Func func, JobCounter* counter)
+{
+    Submit(MakeJob(std::move(func), counter));
+}
+
+template<class Func>
+inline void JobSystem::RunAfter(JobCounter& dependency, Func func, JobCounter* counter)
+{
+    Job* job = MakeJob(std::move(func), counter);
+    {
+        // Finish takes the lock to hand continuations out after the count reaches zero, so
+        // either it sees this one or we see the count already at zero
+        std::lock_guard<std::mutex> lock(dependency.continuationsMutex);
+        if (dependency.pending.load(std::memory_order_acquire) % JOB_COUNTER_FINISHING != 0)
+        {
+            dependency.continuations.push_back(job);
+            return;
+        }
+    }
+    Submit(job);
+}
\ No newline at end of file
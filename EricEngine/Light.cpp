@@ -1,3 +0,0 @@
-#include "Light.h"
-
-int LightComponent::id;
\ No newline at end of file
@@ -1,6 +1,5 @@
 #pragma once
 
-#include "EntityManager.h"
 #include <DirectXMath.h>
 
 #define DIRECTIONAL_LIGHT 0
@@ -16,16 +15,8 @@ struct Light
     float range;
 };
 
-struct LightComponent : ECS::Component
+struct LightComponent
 {
     Light data = {};
-
-    virtual ~LightComponent() {}
-
-    static int id;
-    virtual int ID()
-    {
-        return id;
-    }
 };
 
@@ -1,3 +0,0 @@
-#include "Material.h"
-
-int Material::id;
\ No newline at end of file
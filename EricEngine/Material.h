@@ -1,12 +1,11 @@
 #pragma once
 
-#include "EntityManager.h"
 #include <d3d11.h>
 #include <wrl/client.h>
 #include <string>
 #include "SimpleShader.h"
 
-struct Material : ECS::Component
+struct Material
 {
     std::string albedoName;
     std::string normalsName;
@@ -18,12 +17,4 @@ struct Material : ECS::Component
     std::string vertexShaderName;
 
     DirectX::XMFLOAT3 tint = { 1, 1, 1 };
-
-    virtual ~Material() {}
-
-    static int id;
-    virtual int ID()
-    {
-        return id;
-    }
 };
\ No newline at end of file
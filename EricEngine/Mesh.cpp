@@ -1,3 +0,0 @@
-#include "Mesh.h"
-
-int Mesh::id;
\ No newline at end of file
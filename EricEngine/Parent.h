@@ -0,0 +1,11 @@
+#pragma once
+
+#include "Entity.h"
+
+// Makes an entity's Transform relative to entity's, so it follows it around. TransformSystem
+// keeps the child's world matrix up to date, its position, rotation and scale are local.
+// Change entity through GetComponentForWrite so the hierarchy is rebuilt
+struct Parent
+{
+    ECS::Entity entity = ECS::INVALID_ENTITY;
+};
\ No newline at end of file
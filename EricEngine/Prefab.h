@@ -0,0 +1,21 @@
+#pragma once
+
+#include <tuple>
+#include <boost/mp11.hpp>
+
+namespace ECS
+{
+    // A set of component values to copy onto many new entities at once with
+    // EntityManager::Instantiate:
+    //     Prefab prefab(mesh, transform, material);
+    //     std::vector<Entity> spawned = em.Instantiate(prefab, 1000);
+    template <class... ComponentTypes>
+    struct Prefab
+    {
+        static_assert(boost::mp11::mp_is_set<boost::mp11::mp_list<ComponentTypes...>>::value, "An entity has at most one of each component type");
+
+        std::tuple<ComponentTypes...> components;
+
+        explicit Prefab(const ComponentTypes&... components) : components(components...) {}
+    };
+}
\ No newline at end of file
@@ -1,3 +0,0 @@
-#include "RaycastObject.h"
-
-int RaycastObject::id;
\ No newline at end of file
@@ -1,13 +1,6 @@
 #pragma once
-#include "EntityManager.h"
 
-class RaycastObject : public ECS::Component
+// Marks an entity's mesh as something the raycaster can hit
+struct RaycastObject
 {
-public:
-    static int id;
-    virtual int ID()
-    {
-        return id;
-    }
-};
-
+};
\ No newline at end of file
@@ -4,110 +4,82 @@
 #include "Camera.h"
 #include "Material.h"
 #include "RaycastObject.h"
+#include "Static.h"
 #include "Input.h"
 #include <DirectXMath.h>
+#include <atomic>
+#include <cstring>
 
 using namespace DirectX;
 
-int Raycasting::hitEntity = INVALID_ENTITY;
+ECS::Entity Raycasting::hitEntity = ECS::INVALID_ENTITY;
 
-void Raycasting::Update(float dt)
+Raycasting::Raycasting(const StaticScene* staticScene) : staticScene(staticScene)
 {
-    hitEntity = INVALID_ENTITY;
-
-    auto& em = ECS::EntityManager::GetInstance();
+}
 
-    // Get all meshes in the scene
-    auto entitiesWithMesh = em.GetEntitiesWithComponents<Mesh, Transform, Material, RaycastObject>();
+void Raycasting::Update(ECS::EntityManager& em, float dt)
+{
+    // Only the last hit was tinted
+    Material* lastHit = em.GetComponent<Material>(hitEntity);
+    if (lastHit != nullptr) lastHit->tint = { 1, 1, 1 };
+    hitEntity = ECS::INVALID_ENTITY;
 
     // Camera will be the source of the raycast
-    auto entitiesWithCamera = em.GetEntitiesWithComponents<Camera, Transform>();
-    if (entitiesWithCamera.size() <= 0) return;
-    Transform* cam = em.GetComponent<Transform>(entitiesWithCamera[0]);
-
-    // Test each of the six faces of each mesh's bounding box
-    float t[] = { 0, 0, 0, 0, 0, 0 };
-    // If mint < 0 && maxt < 0, there is no intersection, so default to -1
-    float mint = -1;
-    float maxt = -1;
+    auto cameras = em.GetCachedView<Camera, Transform>();
+    if (cameras.begin() == cameras.end()) return;
+    Transform* cam = &std::get<2>(*cameras.begin());
 
     XMFLOAT3 origin = cam->position;
     XMFLOAT3 direction = cam->forward;
 
-    float closestHit = INFINITY;
-    int closestEntity = INVALID_ENTITY;
-    for (auto& e : entitiesWithMesh)
+    // The closest hit so far as its distance's bits above the entity's handle, so one atomic min
+    // keeps the nearest from every thread, and equally near hits always go to the same entity.
+    // Distances here are never negative, and those order the same way as their bits
+    std::atomic<uint64_t> closest{ UINT64_MAX };
+    auto consider = [&](ECS::Entity e, float hit) {
+        if (!(hit >= 0.0f && hit < INFINITY)) return;
+        uint32_t bits;
+        std::memcpy(&bits, &hit, sizeof(bits));
+        uint64_t packed = ((uint64_t)bits << 32) | e.handle;
+        uint64_t current = closest.load(std::memory_order_relaxed);
+        while (packed < current && !closest.compare_exchange_weak(current, packed, std::memory_order_relaxed)) {}
+    };
+
+    // Test every dynamic raycastable mesh in the scene, spread over the job system
+    bool useStatics = staticScene != nullptr;
+    if (useStatics)
     {
-        auto mesh = em.GetComponent<Mesh>(e);
-        auto transform = em.GetComponent<Transform>(e);
-        em.GetComponent<Material>(e)->tint = { 1, 1, 1 };
-        auto min = mesh->boundingMin;
-        auto max = mesh->boundingMax;
-
-        // Transform ray to model space
-        XMFLOAT3 localOrigin;
-        XMFLOAT3 localDirection;
-        {
-            XMVECTOR start;
-            XMVECTOR directionMath;
-        
-            auto pos = transform->position;
-            auto scale = transform->scale;
-            auto pitchYawRoll = transform->pitchYawRoll;
-
-            auto worldMat = transform->worldMatrix;
-            XMMATRIX invMat = XMMatrixInverse(0, XMLoadFloat4x4(&worldMat));
-
-            // Apply in reverse order
-            XMMATRIX backwardsWorldMat = invMat;
-
-            // Transform ray to local space
-            start = XMLoadFloat3(&origin);
-            directionMath = XMLoadFloat3(&direction);
-            XMVECTOR end = start + directionMath;
-
-            XMVECTOR newOrigin = XMVector3Transform(start, invMat);
-            XMVECTOR newEnd = XMVector3Transform(end, invMat);
-            directionMath = newEnd - newOrigin;
-            XMVECTOR newDir = XMVector3Normalize(directionMath);
-            
-            XMStoreFloat3(&localOrigin, newOrigin);
-            XMStoreFloat3(&localDirection, newDir);
-        }
-
-        XMFLOAT3 dirFrac = localDirection;
-        dirFrac.x = -1.0 * dirFrac.x;
-        dirFrac.y = -1.0 * dirFrac.y;
-        dirFrac.z = -1.0 * dirFrac.z;
-
-        t[0] = (min.x - localOrigin.x) / dirFrac.x;
-        t[1] = (max.x - localOrigin.x) / dirFrac.x;
-        t[2] = (min.y - localOrigin.y) / dirFrac.y;
-        t[3] = (max.y - localOrigin.y) / dirFrac.y;
-        t[4] = (min.z - localOrigin.z) / dirFrac.z;
-        t[5] = (max.z - localOrigin.z) / dirFrac.z;
-
-        mint = (std::max)((std::max)((std::min)(t[0], t[1]), (std::min)(t[2], t[3])), (std::min)(t[4], t[5]));
-        maxt = (std::min)((std::min)((std::max)(t[0], t[1]), (std::max)(t[2], t[3])), (std::max)(t[4], t[5]));
-
-        if (maxt < 0) continue;
-
-        // no intersection
-        if (mint > maxt) continue;
-
-        // Origin is inside of the object
-        float closestT = mint;
-        if (mint < 0.0f) closestT = maxt;
-
-        if (closestHit < 0.0f || closestT < closestHit)
+        em.ParallelForEach<Mesh, Transform, Material, RaycastObject>(
+            [&](ECS::Entity e, const Mesh& mesh, const Transform& transform, const Material&, const RaycastObject&) {
+                consider(e, HitDistance(mesh, transform, origin, direction));
+            }, ECS::Without<Static>());
+
+        // Static ones only if the ray reaches their bounds. HitDistance casts along -direction,
+        // so the scene is asked about that same ray
+        XMFLOAT3 backward = { -direction.x, -direction.y, -direction.z };
+        candidates.clear();
+        staticScene->Raycast(&origin.x, &backward.x, candidates);
+        for (ECS::Entity e : candidates)
         {
-            closestHit = closestT;
-            closestEntity = e;
+            Mesh* mesh = em.GetComponent<Mesh>(e);
+            Transform* transform = em.GetComponent<Transform>(e);
+            if (mesh == nullptr || transform == nullptr) continue;
+            if (!em.HasComponent<Material>(e) || !em.HasComponent<RaycastObject>(e)) continue;
+            consider(e, HitDistance(*mesh, *transform, origin, direction));
         }
     }
+    else
+    {
+        em.ParallelForEach<Mesh, Transform, Material, RaycastObject>(
+            [&](ECS::Entity e, const Mesh& mesh, const Transform& transform, const Material&, const RaycastObject&) {
+                consider(e, HitDistance(mesh, transform, origin, direction));
+            });
+    }
 
     // No intersection
-    if (closestEntity == INVALID_ENTITY) return;
+    if (closest.load(std::memory_order_relaxed) == UINT64_MAX) return;
+    ECS::Entity closestEntity = { (uint32_t)closest.load(std::memory_order_relaxed) };
 
     hitEntity = closestEntity;
 
@@ -118,7 +90,63 @@ void Raycasting::Update(float dt)
     // If we click on the closest entity, destroy it
     if (Input::GetInstance().MouseLeftPress())
     {
-        em.DeregisterEntity(closestEntity);
+        em.GetCommandBuffer().Destroy(closestEntity);
     }
 #endif
 }
+
+
+float Raycasting::HitDistance(const Mesh& mesh, const Transform& transform, XMFLOAT3 origin, XMFLOAT3 direction)
+{
+    auto min = mesh.boundingMin;
+    auto max = mesh.boundingMax;
+
+    // Transform ray to model space
+    XMFLOAT3 localOrigin;
+    XMFLOAT3 localDirection;
+    {
+        XMVECTOR start;
+        XMVECTOR directionMath;
+
+        // TransformSystem keeps the inverse around, so nothing is inverted per entity here
+        XMMATRIX invMat = XMLoadFloat4x4(&transform.worldInverseMatrix);
+
+        // Transform ray to local space
+        start = XMLoadFloat3(&origin);
+        directionMath = XMLoadFloat3(&direction);
+        XMVECTOR end = start + directionMath;
+
+        XMVECTOR newOrigin = XMVector3Transform(start, invMat);
+        XMVECTOR newEnd = XMVector3Transform(end, invMat);
+        directionMath = newEnd - newOrigin;
+        XMVECTOR newDir = XMVector3Normalize(directionMath);
+
+        XMStoreFloat3(&localOrigin, newOrigin);
+        XMStoreFloat3(&localDirection, newDir);
+    }
+
+    XMFLOAT3 dirFrac = localDirection;
+    dirFrac.x = -1.0 * dirFrac.x;
+    dirFrac.y = -1.0 * dirFrac.y;
+    dirFrac.z = -1.0 * dirFrac.z;
+
+    // Test each of the six faces of the mesh's bounding box
+    float t[6];
+    t[0] = (min.x - localOrigin.x) / dirFrac.x;
+    t[1] = (max.x - localOrigin.x) / dirFrac.x;
+    t[2] = (min.y - localOrigin.y) / dirFrac.y;
+    t[3] = (max.y - localOrigin.y) / dirFrac.y;
+    t[4] = (min.z - localOrigin.z) / dirFrac.z;
+    t[5] = (max.z - localOrigin.z) / dirFrac.z;
+
+    float mint = (std::max)((std::max)((std::min)(t[0], t[1]), (std::min)(t[2], t[3])), (std::min)(t[4], t[5]));
+    float maxt = (std::min)((std::min)((std::max)(t[0], t[1]), (std::max)(t[2], t[3])), (std::max)(t[4], t[5]));
+
+    // No intersection
+    if (maxt < 0) return -1;
+    if (mint > maxt) return -1;
+
+    // Origin is inside of the object
+    if (mint < 0.0f) return maxt;
+    return mint;
+}
\ No newline at end of file
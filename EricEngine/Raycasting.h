@@ -1,11 +1,27 @@
 #pragma once
 #include <DirectXMath.h>
+#include "Entity.h"
+#include "EntityManager.h"
+#include "StaticScene.h"
+#include "Transform.h"
+#include "Mesh.h"
 
 class Raycasting
 {
 public:
-    void Update(float dt);
+    // Static entities are only tested if staticScene's bounds say the ray reaches them
+    Raycasting(const StaticScene* staticScene = nullptr);
 
-    static int hitEntity;
+    void Update(ECS::EntityManager& em, float dt);
+
+    static ECS::Entity hitEntity;
+
+private:
+    const StaticScene* staticScene;
+    // Static entities whose group and bounds the ray hit this update
+    std::vector<ECS::Entity> candidates;
+
+    // Distance along the ray to the mesh's bounding box, or a negative number if it misses
+    static float HitDistance(const Mesh& mesh, const Transform& transform, DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction);
 };
 
@@ -15,10 +15,8 @@ Renderer::Renderer(std::shared_ptr<D3DResources> d3dResources, AssetManager* ass
 {
 }
 
-void Renderer::Render()
+void Renderer::Render(ECS::EntityManager& em)
 {
-    auto& em = ECS::EntityManager::GetInstance();
-
     auto context = m_d3dResources->GetContext();
 
     auto renderTarget = m_d3dResources->GetRenderTarget();
@@ -32,14 +30,10 @@ void Renderer::Render()
     // Set render target
     context->OMSetRenderTargets(1, &renderTarget, depthStencilView);
 
-    // Draw each entity
-    // We need a mesh, a transform, and a material
-    std::vector<int> meshTransformIDs = em.GetEntitiesWithComponents<Mesh, Transform, Material>();
-
     // Get our camera for rendering
-    auto cameras = em.GetEntitiesWithComponents<Camera, Transform>();
+    auto cameras = em.GetCachedView<Camera, Transform>();
     // Can't render without a camera
-    if (cameras.size() == 0)
+    if (cameras.begin() == cameras.end())
     {
 #ifdef _DEBUG
         ImGui::EndFrame();
@@ -48,56 +42,87 @@ void Renderer::Render()
 #endif
         return;
     }
-    int cameraIndex = cameras[0];
-    Camera* camera = em.GetComponent<Camera>(cameraIndex);
-    Transform* cameraTransform = em.GetComponent<Transform>(cameraIndex);
+    auto [cameraEntity, cameraComponent, cameraTransformComponent] = *cameras.begin();
+    Camera* camera = &cameraComponent;
+    Transform* cameraTransform = &cameraTransformComponent;
 
     // Grab our light(s)
-    auto lightEntities = em.GetEntitiesWithComponents<LightComponent>();
-    for (int i = 0; i < lightEntities.size() && i < MAX_LIGHTS; i++)
+    int lightCount = 0;
+    for (auto [e, light] : em.GetView<LightComponent>())
     {
-        lights[i] = em.GetComponent<LightComponent>(lightEntities[i])->data;
+        if (lightCount >= MAX_LIGHTS) break;
+        lights[lightCount++] = light.data;
     }
 
-    for (auto& i : meshTransformIDs)
+    // Draws are grouped by shaders, then textures, then mesh, so consecutive draws share as much
+    // state as possible. Only sorts again when a mesh or material changed or drawables came or went
+    m_drawOrder.Update(em);
+
+    // What the previous draw left bound, so draws only set what's different
+    uint64_t boundKey = DRAW_KEY_NONE;
+    SimplePixelShader* pixelShader = nullptr;
+    SimpleVertexShader* vertexShader = nullptr;
+    m_stateChanges = 0;
+
+    // Draw each entity
+    // We need a mesh, a transform, and a material
+    for (auto [e, mesh, transform, material] : em.GetCachedView<Mesh, Transform, Material>())
     {
-        Material* material = em.GetComponent<Material>(i);
-        auto pixelShader = m_assetManager->GetPixelShader(material->pixelShaderName);
-        pixelShader->SetShader();
-        pixelShader->SetShaderResourceView("Albedo", m_assetManager->GetTexture(material->albedoName));
-        pixelShader->SetShaderResourceView("Normals", m_assetManager->GetTexture(material->normalsName));
-        pixelShader->SetShaderResourceView("Metalness", m_assetManager->GetTexture(material->metalnessName));
-        pixelShader->SetShaderResourceView("Roughness", m_assetManager->GetTexture(material->roughnessName));
-        pixelShader->SetShaderResourceView("AO", m_assetManager->GetTexture(material->aoName));
-        pixelShader->SetSamplerState("BasicSampler", m_assetManager->GetSamplerState());
-        pixelShader->SetFloat3("camPosition", cameraTransform->position);
-        pixelShader->SetFloat3("tint", material->tint);
-        if (lights != nullptr)
+        uint64_t key = m_drawOrder.KeyOf(e.Index());
+        bool newPixelShader = DrawOrder::PixelShaderOf(key) != DrawOrder::PixelShaderOf(boundKey);
+        if (newPixelShader)
         {
+            pixelShader = m_assetManager->GetPixelShader(material.pixelShaderName);
+            pixelShader->SetShader();
+            pixelShader->SetSamplerState("BasicSampler", m_assetManager->GetSamplerState());
+            pixelShader->SetFloat3("camPosition", cameraTransform->position);
             pixelShader->SetData("lights", &lights, sizeof(Light) * MAX_LIGHTS);
+            m_stateChanges++;
         }
+        // Another shader can expect its textures in other slots
+        if (newPixelShader || DrawOrder::TexturesOf(key) != DrawOrder::TexturesOf(boundKey))
+        {
+            pixelShader->SetShaderResourceView("Albedo", m_assetManager->GetTexture(material.albedoName));
+            pixelShader->SetShaderResourceView("Normals", m_assetManager->GetTexture(material.normalsName));
+            pixelShader->SetShaderResourceView("Metalness", m_assetManager->GetTexture(material.metalnessName));
+            pixelShader->SetShaderResourceView("Roughness", m_assetManager->GetTexture(material.roughnessName));
+            pixelShader->SetShaderResourceView("AO", m_assetManager->GetTexture(material.aoName));
+            m_stateChanges++;
+        }
+        pixelShader->SetFloat3("tint", material.tint);
         pixelShader->CopyAllBufferData();
 
         // Set up cbuffer data
-        Transform* transform = em.GetComponent<Transform>(i);
-        auto vertexShader = m_assetManager->GetVertexShader(material->vertexShaderName);
-        vertexShader->SetShader();
-        vertexShader->SetMatrix4x4("view", camera->viewMatrix);
-        vertexShader->SetMatrix4x4("projection", camera->projectionMatrix);
-        vertexShader->SetMatrix4x4("model", transform->worldMatrix);
-        vertexShader->SetMatrix4x4("modelInvTranspose", transform->worldInverseTransposeMatrix);
+        if (DrawOrder::VertexShaderOf(key) != DrawOrder::VertexShaderOf(boundKey))
+        {
+            vertexShader = m_assetManager->GetVertexShader(material.vertexShaderName);
+            vertexShader->SetShader();
+            vertexShader->SetMatrix4x4("view", camera->viewMatrix);
+            vertexShader->SetMatrix4x4("projection", camera->projectionMatrix);
+            m_stateChanges++;
+        }
+        vertexShader->SetMatrix4x4("model", transform.worldMatrix);
+        vertexShader->SetMatrix4x4("modelInvTranspose", transform.worldInverseTransposeMatrix);
         vertexShader->CopyAllBufferData();
 
-        Mesh* mesh = em.GetComponent<Mesh>(i);
-        UINT stride = sizeof(Vertex);
-        UINT offset = 0;
-        context->IASetVertexBuffers(0, 1, m_assetManager->GetVertexBuffer(mesh->name).GetAddressOf(), &stride, &offset);
-        context->IASetIndexBuffer(m_assetManager->GetIndexBuffer(mesh->name).Get(), DXGI_FORMAT_R32_UINT, 0);
+        if (DrawOrder::MeshOf(key) != DrawOrder::MeshOf(boundKey))
+        {
+            UINT stride = sizeof(Vertex);
+            UINT offset = 0;
+            context->IASetVertexBuffers(0, 1, m_assetManager->GetVertexBuffer(mesh.name).GetAddressOf(), &stride, &offset);
+            context->IASetIndexBuffer(m_assetManager->GetIndexBuffer(mesh.name).Get(), DXGI_FORMAT_R32_UINT, 0);
+            m_stateChanges++;
+        }
+        boundKey = key;
 
-        context->DrawIndexed(mesh->indices, 0, 0);
+        context->DrawIndexed(mesh.indices, 0, 0);
     }
 
 #ifdef _DEBUG
+    ImGui::Begin("Renderer");
+    ImGui::Text("State changes: %d", m_stateChanges);
+    ImGui::End();
+
     ImGui::EndFrame();
     ImGui::Render();
     ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
@@ -12,6 +12,7 @@
 #include "Camera.h"
 #include "EntityManager.h"
 #include "Light.h"
+#include "DrawOrder.h"
 
 #pragma comment (lib, "d3d11.lib")
 
@@ -22,11 +23,16 @@ class Renderer
 public:
     Renderer(std::shared_ptr<D3DResources> d3dResources, AssetManager* assetManager);
 
-    void Render();
+    void Render(ECS::EntityManager& em);
+
+    // Shader, texture and mesh buffer binds made by the last frame
+    int GetStateChanges() const { return m_stateChanges; }
 
 private:
     std::shared_ptr<D3DResources> m_d3dResources;
     AssetManager* m_assetManager;
     Light lights[MAX_LIGHTS] = {};
+    DrawOrder m_drawOrder;
+    int m_stateChanges = 0;
 };
 
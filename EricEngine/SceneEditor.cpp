@@ -5,6 +5,7 @@
 #include "Transform.h"
 #include "Light.h"
 #include "RaycastObject.h"
+#include "Static.h"
 #include "DirectoryEnumeration.h"
 #include "StringConversion.h"
 #include "TransformSystem.h"
@@ -18,30 +19,38 @@
 #include <string>
 #include <codecvt>
 
-SceneEditor::SceneEditor(SceneLoader* sceneLoader, AssetManager* assetManager)
-    : sceneLoader(sceneLoader), assetManager(assetManager)
+SceneEditor::SceneEditor(ECS::EntityManager* em, SceneLoader* sceneLoader, AssetManager* assetManager)
+    : sceneLoader(sceneLoader), assetManager(assetManager), em(em)
 {
-    em = &ECS::EntityManager::GetInstance();
-    selectedEntity = 0;
+    selectedIndex = 0;
+    selectedEntity = ECS::INVALID_ENTITY;
 }
 
 void SceneEditor::Update(float dt)
 {
     ImGui::Begin("Inspector");
 
-    std::string numEntities = "# of entities: " + std::to_string(em->entityCount);
+    std::string numEntities = "# of entities: " + std::to_string(em->GetEntityCount());
     ImGui::Text(numEntities.c_str());
 
-    ImGui::InputInt("Selected Entity: ", &selectedEntity);
-    if (ImGui::Button("Select Highlighted Entity"))
+    ImGui::InputInt("Selected Entity: ", &selectedIndex);
+    if (ImGui::Button("Select Highlighted Entity") && em->IsAlive(Raycasting::hitEntity))
     {
-        selectedEntity = Raycasting::hitEntity;
+        selectedIndex = Raycasting::hitEntity.Index();
+    }
+    int slotCount = em->GetSlotCount();
+    if (selectedIndex >= slotCount) selectedIndex = slotCount - 1;
+    if (selectedIndex < 0) selectedIndex = 0;
+    selectedEntity = ECS::INVALID_ENTITY;
+    if (em->GetEntityCount() > 0)
+    {
+        // If we selected an invalid entity, find a valid one
+        while ((selectedEntity = em->GetEntity(selectedIndex)) == ECS::INVALID_ENTITY)
+        {
+            selectedIndex = (selectedIndex + 1) % slotCount;
+        }
+        SelectedEntityUI();
     }
-    if (selectedEntity < 0) selectedEntity = 0;
-    if (selectedEntity >= MAX_ENTITIES) selectedEntity = MAX_ENTITIES - 1;
-    // If we selected an invalid entity, find a valid one
-    while (!em->entities[selectedEntity]) selectedEntity = (selectedEntity + 1) % MAX_ENTITIES;
-    SelectedEntityUI();
 
     ImGui::End();
 
@@ -49,24 +58,63 @@ void SceneEditor::Update(float dt)
 
     if (ImGui::Button("Add Entity"))
     {
-        em->RegisterNewEntity();
+        em->ReserveEntity();
     }
 
     // For every entity
-    for (int i = 0; i < MAX_ENTITIES; i++)
+    for (int i = 0; i < em->GetSlotCount(); i++)
     {
-        if (!em->entities[i]) continue;
+        ECS::Entity e = em->GetEntity(i);
+        if (e == ECS::INVALID_ENTITY) continue;
         // Display every entity
         std::string entityString = "Entity " + std::to_string(i);
         if (ImGui::TreeNode(entityString.c_str()))
         {
             // Display all the entity's components
-            DisplayEntityComponents(i);
+            DisplayEntityComponents(e);
             ImGui::TreePop();
         }
     }
 
     ImGui::End();
+
+    StatsUI();
+}
+
+void SceneEditor::StatsUI()
+{
+    ECS::EntityManagerStats stats = em->GetStats();
+
+    ImGui::Begin("ECS Stats");
+
+    ImGui::Text("Entities: %d / %d slots (%d free)", stats.entityCount, stats.slotCount, stats.freeSlots);
+    ImGui::Text("Reserved: %.1f KB", stats.TotalBytesReserved() / 1024.0f);
+    if (ImGui::Button("Copy JSON"))
+    {
+        ImGui::SetClipboardText(stats.ToJson().c_str());
+    }
+
+    if (ImGui::TreeNode("Pools"))
+    {
+        for (const auto& pool : stats.pools)
+        {
+            ImGui::Text("%s: %d / %d, %.1f / %.1f KB, %.0f%% unused, %d allocations", pool.name, pool.count, pool.capacity,
+                pool.bytesUsed / 1024.0f, pool.bytesReserved / 1024.0f, pool.fragmentation * 100.0f, pool.allocations);
+        }
+        ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNode("Cached Queries"))
+    {
+        for (const auto& query : stats.queries)
+        {
+            ImGui::Text("Requires %08x, excludes %08x: %d matches, built in %.3f ms, %lld updates", query.required,
+                query.excluded, query.matches, query.buildMilliseconds, (long long)query.updates);
+        }
+        ImGui::TreePop();
+    }
+
+    ImGui::End();
 }
 
 bool SceneEditor::DisplayMeshDropdown()
@@ -119,29 +167,26 @@ bool SceneEditor::DisplayTextureDropdown(std::string dropdownName, std::string*
     return anythingSelected;
 }
 
-void SceneEditor::ReplaceMaterial(int entity, Material* newMat)
+void SceneEditor::ReplaceMaterial(ECS::Entity entity, const Material& newMat)
 {
-    em->RemoveComponent<Material>(entity);
-    em->AddComponent<Material>(entity, newMat);
+    em->GetCommandBuffer().RemoveComponent<Material>(entity);
+    em->GetCommandBuffer().AddComponent<Material>(entity, newMat);
 
 }
 
 void SceneEditor::SelectedEntityUI()
 {
-    Mesh* mesh = nullptr;
-    if (em->EntityHasComponent(Mesh::id, selectedEntity)) mesh = em->GetComponent<Mesh>(selectedEntity);
+    Mesh* mesh = em->GetComponent<Mesh>(selectedEntity);
+
+    Material* material = em->GetComponent<Material>(selectedEntity);
 
-    Material* material = nullptr;
-    if (em->EntityHasComponent(Material::id, selectedEntity)) material = em->GetComponent<Material>(selectedEntity);
+    Transform* transform = em->GetComponent<Transform>(selectedEntity);
 
-    Transform* transform = nullptr;
-    if (em->EntityHasComponent(Transform::id, selectedEntity)) transform = em->GetComponent<Transform>(selectedEntity);
+    LightComponent* light = em->GetComponent<LightComponent>(selectedEntity);
 
-    LightComponent* light = nullptr;
-    if (em->EntityHasComponent(LightComponent::id, selectedEntity)) light = em->GetComponent<LightComponent>(selectedEntity);
+    RaycastObject* ro = em->GetComponent<RaycastObject>(selectedEntity);
 
-    RaycastObject* ro = nullptr;
-    if (em->EntityHasComponent(RaycastObject::id, selectedEntity)) ro = em->GetComponent<RaycastObject>(selectedEntity);
+    Static* isStatic = em->GetComponent<Static>(selectedEntity);
 
     // Display any existing components
     DisplayEntityComponents(selectedEntity);
@@ -149,9 +194,10 @@ void SceneEditor::SelectedEntityUI()
     // For non-existing components--allow the user to add them
     if (mesh == nullptr && ImGui::TreeNode("New Mesh Component"))
     {
-        if (DisplayMeshDropdown())
+        Mesh* newMesh = nullptr;
+        if (DisplayMeshDropdown() && (newMesh = assetManager->GetMesh(selectedMesh)) != nullptr)
         {
-            em->AddComponent<Mesh>(selectedEntity, assetManager->GetMesh(selectedMesh));
+            em->GetCommandBuffer().AddComponent<Mesh>(selectedEntity, *newMesh);
         }
         ImGui::TreePop();
     }
@@ -168,37 +214,33 @@ void SceneEditor::SelectedEntityUI()
 
         if (ImGui::Button("Add Material"))
         {
-            Material* material = new Material();
-
-            material->albedoName = albedoName;
-            material->normalsName = normalsName;
-            material->metalnessName = metalnessName;
-            material->roughnessName = roughnessName;
-            material->aoName = aoName;
-            material->pixelShaderName = pixelShaderName;
-            material->vertexShaderName = vertexShaderName;
-
-            auto albedo = assetManager->GetTexture(material->albedoName);
-            auto normals = assetManager->GetTexture(material->normalsName);
-            auto metalness = assetManager->GetTexture(material->metalnessName);
-            auto roughness = assetManager->GetTexture(material->roughnessName);
-            auto ao = assetManager->GetTexture(material->aoName);
-            auto ps = assetManager->GetPixelShader(material->pixelShaderName);
-            auto vs = assetManager->GetVertexShader(material->vertexShaderName);
-
-            if (albedo == nullptr
-                || normals == nullptr
-                || metalness == nullptr
-                || roughness == nullptr
-                || ao == nullptr
-                || ps == nullptr
-                || vs == nullptr)
-            {
-                delete material;
-            }
-            else
+            Material material;
+
+            material.albedoName = albedoName;
+            material.normalsName = normalsName;
+            material.metalnessName = metalnessName;
+            material.roughnessName = roughnessName;
+            material.aoName = aoName;
+            material.pixelShaderName = pixelShaderName;
+            material.vertexShaderName = vertexShaderName;
+
+            auto albedo = assetManager->GetTexture(material.albedoName);
+            auto normals = assetManager->GetTexture(material.normalsName);
+            auto metalness = assetManager->GetTexture(material.metalnessName);
+            auto roughness = assetManager->GetTexture(material.roughnessName);
+            auto ao = assetManager->GetTexture(material.aoName);
+            auto ps = assetManager->GetPixelShader(material.pixelShaderName);
+            auto vs = assetManager->GetVertexShader(material.vertexShaderName);
+
+            if (albedo != nullptr
+                && normals != nullptr
+                && metalness != nullptr
+                && roughness != nullptr
+                && ao != nullptr
+                && ps != nullptr
+                && vs != nullptr)
             {
-                em->AddComponent<Material>(selectedEntity, material);
+                em->GetCommandBuffer().AddComponent<Material>(selectedEntity, material);
             }
         }
         ImGui::TreePop();
@@ -212,13 +254,13 @@ void SceneEditor::SelectedEntityUI()
 
         if (ImGui::Button("Add Transform"))
         {
-            Transform* transform = new Transform();
+            Transform transform;
 
-            TransformSystem::SetPosition(transform, pos.x, pos.y, pos.z);
-            TransformSystem::SetScale(transform, scale.x, scale.y, scale.z);
-            TransformSystem::SetPitchYawRoll(transform, pitchYawRoll.x, pitchYawRoll.y, pitchYawRoll.z);
+            TransformSystem::SetPosition(&transform, pos.x, pos.y, pos.z);
+            TransformSystem::SetScale(&transform, scale.x, scale.y, scale.z);
+            TransformSystem::SetPitchYawRoll(&transform, pitchYawRoll.x, pitchYawRoll.y, pitchYawRoll.z);
 
-            em->AddComponent<Transform>(selectedEntity, transform);
+            em->GetCommandBuffer().AddComponent<Transform>(selectedEntity, transform);
         }
         ImGui::TreePop();
     }
@@ -236,16 +278,16 @@ void SceneEditor::SelectedEntityUI()
 
             if (ImGui::Button("Add Light"))
             {
-                LightComponent* light = new LightComponent();
+                LightComponent light;
 
-                light->data.lightType = lightType;
-                light->data.dir = dir;
-                light->data.color = color;
-                light->data.intensity = intensity;
-                light->data.pos = lightPos;
-                light->data.range = range;
+                light.data.lightType = lightType;
+                light.data.dir = dir;
+                light.data.color = color;
+                light.data.intensity = intensity;
+                light.data.pos = lightPos;
+                light.data.range = range;
 
-                em->AddComponent<LightComponent>(selectedEntity, light);
+                em->GetCommandBuffer().AddComponent<LightComponent>(selectedEntity, light);
             }
             ImGui::TreePop();
         }
@@ -256,29 +298,35 @@ void SceneEditor::SelectedEntityUI()
     {
         if (ImGui::Button("Add Raycast Object"))
         {
-            em->AddComponent<RaycastObject>(selectedEntity, new RaycastObject());
+            em->GetCommandBuffer().AddComponent<RaycastObject>(selectedEntity, RaycastObject());
+        }
+        ImGui::TreePop();
+    }
+
+    if (isStatic == nullptr && ImGui::TreeNode("New Static Component"))
+    {
+        if (ImGui::Button("Make Static"))
+        {
+            em->GetCommandBuffer().AddComponent<Static>(selectedEntity, Static());
         }
         ImGui::TreePop();
     }
 }
 
-void SceneEditor::DisplayEntityComponents(int e)
+void SceneEditor::DisplayEntityComponents(ECS::Entity e)
 {
 
-    Mesh* mesh = nullptr;
-    if (em->EntityHasComponent(Mesh::id, e)) mesh = em->GetComponent<Mesh>(e);
+    Mesh* mesh = em->GetComponent<Mesh>(e);
 
-    Material* material = nullptr;
-    if (em->EntityHasComponent(Material::id, e)) material = em->GetComponent<Material>(e);
+    Material* material = em->GetComponent<Material>(e);
 
-    Transform* transform = nullptr;
-    if (em->EntityHasComponent(Transform::id, e)) transform = em->GetComponent<Transform>(e);
+    Transform* transform = em->GetComponent<Transform>(e);
 
-    LightComponent* light = nullptr;
-    if (em->EntityHasComponent(LightComponent::id, e)) light = em->GetComponent<LightComponent>(e);
+    LightComponent* light = em->GetComponent<LightComponent>(e);
 
-    RaycastObject* ro = nullptr;
-    if (em->EntityHasComponent(RaycastObject::id, e)) ro = em->GetComponent<RaycastObject>(e);
+    RaycastObject* ro = em->GetComponent<RaycastObject>(e);
+
+    Static* isStatic = em->GetComponent<Static>(e);
 
     if (mesh != nullptr)
     {
@@ -286,14 +334,15 @@ void SceneEditor::DisplayEntityComponents(int e)
         if (ImGui::TreeNode("Mesh"))
         {
             ImGui::Text(mesh->name.c_str());
-            if (DisplayMeshDropdown())
+            Mesh* newMesh = nullptr;
+            if (DisplayMeshDropdown() && (newMesh = assetManager->GetMesh(selectedMesh)) != nullptr)
             {
-                em->RemoveComponent<Mesh>(e);
-                em->AddComponent<Mesh>(e, assetManager->GetMesh(selectedMesh));
+                em->GetCommandBuffer().RemoveComponent<Mesh>(e);
+                em->GetCommandBuffer().AddComponent<Mesh>(e, *newMesh);
             }
             if (ImGui::Button("Remove Mesh"))
             {
-                em->RemoveComponent<Mesh>(e);
+                em->GetCommandBuffer().RemoveComponent<Mesh>(e);
             }
             ImGui::TreePop();
         }
@@ -311,15 +360,15 @@ void SceneEditor::DisplayEntityComponents(int e)
             changedTexture |= DisplayTextureDropdown("AmbientOcclusion", &material->aoName);
             if (changedTexture)
             {
-                Material* mat = new Material();
+                Material mat;
 
-                mat->albedoName = material->albedoName;
-                mat->normalsName = material->normalsName;
-                mat->metalnessName = material->metalnessName;
-                mat->roughnessName = material->roughnessName;
-                mat->aoName = material->aoName;
-                mat->pixelShaderName = material->pixelShaderName;
-                mat->vertexShaderName = material->vertexShaderName;
+                mat.albedoName = material->albedoName;
+                mat.normalsName = material->normalsName;
+                mat.metalnessName = material->metalnessName;
+                mat.roughnessName = material->roughnessName;
+                mat.aoName = material->aoName;
+                mat.pixelShaderName = material->pixelShaderName;
+                mat.vertexShaderName = material->vertexShaderName;
 
                 ReplaceMaterial(e, mat);
                 ImGui::TreePop();
@@ -329,7 +378,7 @@ void SceneEditor::DisplayEntityComponents(int e)
             ImGui::Text(("VertexShader: " + material->vertexShaderName).c_str());
             if (ImGui::Button("Remove Material"))
             {
-                em->RemoveComponent<Material>(e);
+                em->GetCommandBuffer().RemoveComponent<Material>(e);
             }
             ImGui::TreePop();
         }
@@ -343,23 +392,26 @@ void SceneEditor::DisplayEntityComponents(int e)
             if (ImGui::DragFloat3("Position: ", &position.x, 0.05f))
             {
                 TransformSystem::SetPosition(transform, position.x, position.y, position.z);
+                em->MarkChanged<Transform>(e);
             }
 
             auto scale = transform->scale;
             if (ImGui::DragFloat3("Scale: ", &scale.x, 0.05f))
             {
                 TransformSystem::SetScale(transform, scale.x, scale.y, scale.z);
+                em->MarkChanged<Transform>(e);
             }
 
             auto pitchYawRoll = transform->pitchYawRoll;
             if (ImGui::DragFloat3("PitchYawRoll: ", &pitchYawRoll.x, 3.14f / 360.0f))
             {
                 TransformSystem::SetPitchYawRoll(transform, pitchYawRoll.x, pitchYawRoll.y, pitchYawRoll.z);
+                em->MarkChanged<Transform>(e);
             }
 
             if (ImGui::Button("Remove Transform"))
             {
-                em->RemoveComponent<Transform>(e);
+                em->GetCommandBuffer().RemoveComponent<Transform>(e);
             }
             ImGui::TreePop();
         }
@@ -408,7 +460,7 @@ void SceneEditor::DisplayEntityComponents(int e)
 
             if (ImGui::Button("Remove Light"))
             {
-                em->RemoveComponent<LightComponent>(e);
+                em->GetCommandBuffer().RemoveComponent<LightComponent>(e);
             }
             ImGui::TreePop();
         }
@@ -420,7 +472,21 @@ void SceneEditor::DisplayEntityComponents(int e)
         {
             if (ImGui::Button("Remove Raycast Object"))
             {
-                em->RemoveComponent<RaycastObject>(e);
+                em->GetCommandBuffer().RemoveComponent<RaycastObject>(e);
+            }
+            ImGui::TreePop();
+        }
+    }
+    if (isStatic != nullptr)
+    {
+        ImGui::SetNextItemOpen(true);
+        if (ImGui::TreeNode("Static"))
+        {
+            // Every edit to a static transform rebakes all static entities
+            ImGui::Text("Baked, editing the transform rebakes the static scene");
+            if (ImGui::Button("Make Dynamic"))
+            {
+                em->GetCommandBuffer().RemoveComponent<Static>(e);
             }
             ImGui::TreePop();
         }
@@ -8,7 +8,7 @@
 class SceneEditor
 {
 public:
-    SceneEditor(SceneLoader* sceneLoader, AssetManager* assetManager);
+    SceneEditor(ECS::EntityManager* em, SceneLoader* sceneLoader, AssetManager* assetManager);
 
     void Update(float dt);
 
@@ -16,7 +16,9 @@ private:
     SceneLoader* sceneLoader;
     AssetManager* assetManager;
     ECS::EntityManager* em;
-    int selectedEntity;
+    // Slot index typed into the inspector, and the entity living there
+    int selectedIndex;
+    ECS::Entity selectedEntity;
 
     char meshName[32] = "cube.obj";
 
@@ -43,9 +45,11 @@ private:
     std::string selectedMesh = "cube.obj";
 
     void SelectedEntityUI();
-    void DisplayEntityComponents(int e);
+    // Memory use and cached queries of the EntityManager
+    void StatsUI();
+    void DisplayEntityComponents(ECS::Entity e);
     bool DisplayMeshDropdown();
     bool DisplayTextureDropdown(std::string dropdownName, std::string* dataString);
-    void ReplaceMaterial(int entity, Material* newMat);
+    void ReplaceMaterial(ECS::Entity entity, const Material& newMat);
 };
 
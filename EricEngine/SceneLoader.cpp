@@ -1,37 +1,44 @@
 #include "SceneLoader.h"
 #include "DirectoryEnumeration.h"
 #include "RaycastObject.h"
+#include "Static.h"
 
-SceneLoader::SceneLoader(AssetManager* am) : am(am)
+SceneLoader::SceneLoader(ECS::EntityManager* em, AssetManager* am) : em(em), am(am)
 {
-    this->em = &ECS::EntityManager::GetInstance();
 }
 
 void SceneLoader::SaveScene(std::string name)
 {
-    // Grab the array of entities for convenience
-    auto* entities = em->entities;
-
     std::ofstream os;
     os.open(DirectoryEnumeration::GetExePath() + "../../Levels/" + name, std::ios::binary | std::ios::out);
 
     // Write total entity amount
-    int count = em->entityCount;
+    int count = em->GetEntityCount();
     os.write((char*)(&count), sizeof(int));
 
+    // Where each entity lands in the file, so children can refer to their parents
+    fileOrder.assign(em->GetSlotCount(), INVALID_INDEX);
+    for (int i = 0, position = 0; i < em->GetSlotCount(); i++)
+    {
+        if (em->GetEntity(i) != ECS::INVALID_ENTITY) fileOrder[i] = position++;
+    }
+
     // Write every component for every existing entity
-    for (int i = 0; i < MAX_ENTITIES; i++)
+    for (int i = 0; i < em->GetSlotCount(); i++)
     {
-        if (!entities[i]) continue;
+        ECS::Entity e = em->GetEntity(i);
+        if (e == ECS::INVALID_ENTITY) continue;
 
         // Count the number of components we have
         int components = 0;
-        Mesh* mesh = em->GetComponent<Mesh>(i);
-        Material* material = em->GetComponent<Material>(i);
-        Camera* camera = em->GetComponent<Camera>(i);
-        Transform* transform = em->GetComponent<Transform>(i);
-        LightComponent* light = em->GetComponent<LightComponent>(i);
-        RaycastObject* ro = em->GetComponent<RaycastObject>(i);
+        Mesh* mesh = em->GetComponent<Mesh>(e);
+        Material* material = em->GetComponent<Material>(e);
+        Camera* camera = em->GetComponent<Camera>(e);
+        Transform* transform = em->GetComponent<Transform>(e);
+        LightComponent* light = em->GetComponent<LightComponent>(e);
+        RaycastObject* ro = em->GetComponent<RaycastObject>(e);
+        Parent* parent = em->GetComponent<Parent>(e);
+        Static* isStatic = em->GetComponent<Static>(e);
 
         if (mesh != nullptr) components++;
         if (material != nullptr) components++;
@@ -39,6 +46,8 @@ void SceneLoader::SaveScene(std::string name)
         if (transform != nullptr) components++;
         if (light != nullptr) components++;
         if (ro != nullptr) components++;
+        if (parent != nullptr) components++;
+        if (isStatic != nullptr) components++;
 
         // Write the number of components, then write each component
         os.write((char*)(&components), sizeof(int));
@@ -48,6 +57,8 @@ void SceneLoader::SaveScene(std::string name)
         WriteComponent<Transform>(transform, os);
         WriteComponent<LightComponent>(light, os);
         WriteComponent<RaycastObject>(ro, os);
+        WriteComponent<Parent>(parent, os);
+        WriteComponent<Static>(isStatic, os);
     }
 
     os.close();
@@ -63,6 +74,9 @@ void SceneLoader::LoadScene(std::string name)
     int entityCount = -1;
     in.read((char*)(&entityCount), sizeof(int));
 
+    std::vector<ECS::Entity> loaded;
+    pendingParents.clear();
+
     // Read entity by entity.
     // Entities are written like:
     // #ofcomponents_componentID_component
@@ -70,7 +84,8 @@ void SceneLoader::LoadScene(std::string name)
     for (int i = 0; i < entityCount; i++)
     {
         // Register this entity
-        int e = em->RegisterNewEntity();
+        ECS::Entity e = em->RegisterNewEntity();
+        loaded.push_back(e);
 
         // Get total number of components
         int numComponents = -1;
@@ -82,82 +97,109 @@ void SceneLoader::LoadScene(std::string name)
             int componentID = INVALID_COMPONENT;
             in.read((char*)(&componentID), sizeof(int));
 
-            // Read in the component itself
-            ECS::Component* component = ReadComponent(in, componentID);
-
-            // Add the component to its entity
-            em->AddComponent(componentID, e, component);
+            // Read in the component itself and add it to its entity
+            ReadComponent(in, componentID, e);
         }
     }
 
+    // Every entity exists now, so parents can be hooked up
+    for (auto& [child, position] : pendingParents)
+    {
+        if (position < 0 || position >= (int)loaded.size()) continue;
+        em->AddComponent(child, Parent{ loaded[position] });
+    }
+    pendingParents.clear();
+
     in.close();
 }
 
-ECS::Component* SceneLoader::ReadComponent(std::ifstream& in, int componentID)
+void SceneLoader::ReadComponent(std::ifstream& in, int componentID, ECS::Entity entity)
 {
     // Handle any special cases
-    if (componentID == Mesh::id)
+    if (componentID == ECS::ComponentID<Mesh>)
     {
         // Just grab the mesh using its name
-        return am->GetMesh(ReadString(in));
+        Mesh* mesh = am->GetMesh(ReadString(in));
+        if (mesh != nullptr) em->AddComponent(entity, *mesh);
+        return;
+    }
+
+    if (componentID == ECS::ComponentID<Transform>)
+    {
+        Transform transform;
+        in.read((char*)(&transform.position), sizeof(DirectX::XMFLOAT3));
+        in.read((char*)(&transform.pitchYawRoll), sizeof(DirectX::XMFLOAT3));
+        in.read((char*)(&transform.scale), sizeof(DirectX::XMFLOAT3));
+        in.read((char*)(&transform.worldMatrix), sizeof(DirectX::XMFLOAT4X4));
+        in.read((char*)(&transform.worldInverseTransposeMatrix), sizeof(DirectX::XMFLOAT4X4));
+        in.read((char*)(&transform.matricesDirty), sizeof(bool));
+        // Only the matrices are saved, the inverse and rotation get rebuilt from scratch
+        transform.matricesDirty = true;
+        em->AddComponent(entity, transform);
+        return;
     }
 
-    if (componentID == Transform::id)
+    if (componentID == ECS::ComponentID<Material>)
     {
-        Transform* transform = new Transform();
-        in.read((char*)(&transform->position), sizeof(DirectX::XMFLOAT3));
-        in.read((char*)(&transform->pitchYawRoll), sizeof(DirectX::XMFLOAT3));
-        in.read((char*)(&transform->scale), sizeof(DirectX::XMFLOAT3));
-        in.read((char*)(&transform->worldMatrix), sizeof(DirectX::XMFLOAT4X4));
-        in.read((char*)(&transform->worldInverseTransposeMatrix), sizeof(DirectX::XMFLOAT4X4));
-        in.read((char*)(&transform->matricesDirty), sizeof(bool));
-        return transform;
+        Material material;
+        material.albedoName = ReadWString(in);
+        material.normalsName = ReadWString(in);
+        material.metalnessName = ReadWString(in);
+        material.roughnessName = ReadWString(in);
+        material.aoName = ReadWString(in);
+        material.pixelShaderName = ReadWString(in);
+        material.vertexShaderName = ReadWString(in);
+
+        em->AddComponent(entity, material);
+        return;
     }
 
-    if (componentID == Material::id)
+    if (componentID == ECS::ComponentID<Camera>)
     {
-        Material* material = new Material();
-        material->albedoName = ReadWString(in);
-        material->normalsName = ReadWString(in);
-        material->metalnessName = ReadWString(in);
-        material->roughnessName = ReadWString(in);
-        material->aoName = ReadWString(in);
-        material->pixelShaderName = ReadWString(in);
-        material->vertexShaderName = ReadWString(in);
-
-        return material;
+        Camera cam = Camera();
+        in.read((char*)(&cam.movementSpeed), sizeof(float));
+        in.read((char*)(&cam.mouseLookSpeed), sizeof(float));
+        in.read((char*)(&cam.fieldOfView), sizeof(float));
+        in.read((char*)(&cam.aspectRatio), sizeof(float));
+        in.read((char*)(&cam.perspective), sizeof(bool));
+        in.read((char*)(&cam.orthoSize), sizeof(float));
+
+        em->AddComponent(entity, cam);
+        return;
     }
 
-    if (componentID == Camera::id)
+    if (componentID == ECS::ComponentID<LightComponent>)
     {
-        Camera* cam = new Camera();
-        in.read((char*)(&cam->movementSpeed), sizeof(float));
-        in.read((char*)(&cam->mouseLookSpeed), sizeof(float));
-        in.read((char*)(&cam->fieldOfView), sizeof(float));
-        in.read((char*)(&cam->aspectRatio), sizeof(float));
-        in.read((char*)(&cam->perspective), sizeof(bool));
-        in.read((char*)(&cam->orthoSize), sizeof(float));
-
-        return cam;
+        LightComponent light{};
+        in.read((char*)(&light.data.lightType), sizeof(int));
+        in.read((char*)(&light.data.dir), sizeof(DirectX::XMFLOAT3));
+        in.read((char*)(&light.data.color), sizeof(DirectX::XMFLOAT3));
+        in.read((char*)(&light.data.intensity), sizeof(float));
+        in.read((char*)(&light.data.pos), sizeof(DirectX::XMFLOAT3));
+        in.read((char*)(&light.data.range), sizeof(float));
+        em->AddComponent(entity, light);
+        return;
     }
 
-    if (componentID == LightComponent::id)
+    if (componentID == ECS::ComponentID<RaycastObject>)
     {
-        LightComponent* light = new LightComponent{};
-        in.read((char*)(&light->data.lightType), sizeof(int));
-        in.read((char*)(&light->data.dir), sizeof(DirectX::XMFLOAT3));
-        in.read((char*)(&light->data.color), sizeof(DirectX::XMFLOAT3));
-        in.read((char*)(&light->data.intensity), sizeof(float));
-        in.read((char*)(&light->data.pos), sizeof(DirectX::XMFLOAT3));
-        in.read((char*)(&light->data.range), sizeof(float));
-        return light;
+        em->AddComponent(entity, RaycastObject());
+        return;
     }
 
-    if (componentID == RaycastObject::id)
+    if (componentID == ECS::ComponentID<Static>)
     {
-        RaycastObject* ro = new RaycastObject();
-        return ro;
+        em->AddComponent(entity, Static());
+        return;
+    }
+
+    if (componentID == ECS::ComponentID<Parent>)
+    {
+        int position = INVALID_INDEX;
+        in.read((char*)(&position), sizeof(int));
+        pendingParents.push_back({ entity, position });
+        return;
     }
 
     throw;
-}
+}
\ No newline at end of file
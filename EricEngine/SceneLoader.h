@@ -11,6 +11,7 @@
 #include "Material.h"
 #include "Camera.h"
 #include "Light.h"
+#include "Parent.h"
 
 #include "EntityManager.h"
 #include "AssetManager.h"
@@ -25,7 +26,14 @@ private:
     template <typename ComponentType>
     void WriteComponent(ComponentType* component, std::ofstream& os);
 
-    ECS::Component* ReadComponent(std::ifstream& in, int componentID);
+    // Reads the component with the given id and adds it to entity
+    void ReadComponent(std::ifstream& in, int componentID, ECS::Entity entity);
+
+    // Parents are saved as the position of the parent in the file, since handles don't survive
+    // a reload. Accessed like fileOrder[entityIndex] while saving
+    std::vector<int> fileOrder;
+    // Children read so far and the file position of their parent, the parent may come later
+    std::vector<std::pair<ECS::Entity, int>> pendingParents;
 
     // WString methods adapted from
     // https://stackoverflow.com/questions/23399931/c-reading-string-from-binary-file-using-fstream
@@ -62,7 +70,8 @@ private:
     }
 
 public:
-    SceneLoader(AssetManager* am);
+    // Saves and loads the entities in em
+    SceneLoader(ECS::EntityManager* em, AssetManager* am);
 
     void SaveScene(std::string name);
     void LoadScene(std::string name);
@@ -74,7 +83,8 @@ inline void SceneLoader::WriteComponent(ComponentType* component, std::ofstream&
     if (component == nullptr) return;
 
     // By default, just write the component ID
-    os.write((char*)(&ComponentType::id), sizeof(int));
+    int id = ECS::ComponentID<ComponentType>;
+    os.write((char*)(&id), sizeof(int));
 }
 
 template <>
@@ -82,7 +92,8 @@ inline void SceneLoader::WriteComponent<Camera>(Camera* camera, std::ofstream& o
 {
     if (camera == nullptr) return;
 
-    os.write((char*)(&Camera::id), sizeof(int));
+    int id = ECS::ComponentID<Camera>;
+    os.write((char*)(&id), sizeof(int));
     os.write((char*)(&camera->movementSpeed), sizeof(float));
     os.write((char*)(&camera->mouseLookSpeed), sizeof(float));
     os.write((char*)(&camera->fieldOfView), sizeof(float));
@@ -97,7 +108,8 @@ inline void SceneLoader::WriteComponent<Mesh>(Mesh* mesh, std::ofstream& os)
     if (mesh == nullptr) return;
 
     // Write the component ID, then write the component
-    os.write((char*)(&Mesh::id), sizeof(int));
+    int id = ECS::ComponentID<Mesh>;
+    os.write((char*)(&id), sizeof(int));
     size_t nameLen = mesh->name.length();
     os.write((char*)(&nameLen), sizeof(size_t));
     os.write(mesh->name.c_str(), nameLen);
@@ -109,7 +121,8 @@ inline void SceneLoader::WriteComponent<Material>(Material* material, std::ofstr
     if (material == nullptr) return;
 
     // Write the component ID, then write the component
-    os.write((char*)(&Material::id), sizeof(int));
+    int id = ECS::ComponentID<Material>;
+    os.write((char*)(&id), sizeof(int));
     WriteWString(StringConversion::StringToWString(material->albedoName), os);
     WriteWString(StringConversion::StringToWString(material->normalsName), os);
     WriteWString(StringConversion::StringToWString(material->metalnessName), os);
@@ -124,7 +137,8 @@ inline void SceneLoader::WriteComponent<LightComponent>(LightComponent* light, s
 {
     if (light == nullptr) return;
 
-    os.write((char*)(&LightComponent::id), sizeof(int));
+    int id = ECS::ComponentID<LightComponent>;
+    os.write((char*)(&id), sizeof(int));
     os.write((char*)(&light->data.lightType), sizeof(int));
     os.write((char*)(&light->data.dir), sizeof(DirectX::XMFLOAT3));
     os.write((char*)(&light->data.color), sizeof(DirectX::XMFLOAT3));
@@ -133,12 +147,25 @@ inline void SceneLoader::WriteComponent<LightComponent>(LightComponent* light, s
     os.write((char*)(&light->data.range), sizeof(float));
 }
 
+template <>
+inline void SceneLoader::WriteComponent<Parent>(Parent* parent, std::ofstream& os)
+{
+    if (parent == nullptr) return;
+
+    int id = ECS::ComponentID<Parent>;
+    os.write((char*)(&id), sizeof(int));
+    // A parent that's gone is saved as no parent
+    int position = em->IsAlive(parent->entity) ? fileOrder[parent->entity.Index()] : INVALID_INDEX;
+    os.write((char*)(&position), sizeof(int));
+}
+
 template <>
 inline void SceneLoader::WriteComponent<Transform>(Transform* transform, std::ofstream& os)
 {
     if (transform == nullptr) return;
 
-    os.write((char*)(&Transform::id), sizeof(int));
+    int id = ECS::ComponentID<Transform>;
+    os.write((char*)(&id), sizeof(int));
     os.write((char*)(&transform->position), sizeof(DirectX::XMFLOAT3));
     os.write((char*)(&transform->pitchYawRoll), sizeof(DirectX::XMFLOAT3));
     os.write((char*)(&transform->scale), sizeof(DirectX::XMFLOAT3));
@@ -0,0 +1,136 @@
+#include "Scheduler.h"
+#include "JobSystem.h"
+
+#include <cassert>
+#include <thread>
+
+using namespace ECS;
+
+#ifdef _DEBUG
+// What the system running on this thread declared, nullptr between systems
+static thread_local const SystemAccess* runningAccess = nullptr;
+
+void ECS::CheckSystemAccess(Signature components, bool write)
+{
+    if (runningAccess == nullptr) return;
+
+    Signature declared = write ? runningAccess->writes : (runningAccess->reads | runningAccess->writes);
+    assert((components & ~declared) == 0 && "System accessed a component it didn't declare");
+    assert((!write || (runningAccess->entitiesWith | runningAccess->entitiesWithout) == 0)
+        && "Systems limited to some entities can't mark changes, the change log is shared by the whole pool");
+}
+
+void ECS::CheckStructuralChange()
+{
+    assert(runningAccess == nullptr && "Systems have to make structural changes through a CommandBuffer");
+}
+#endif
+
+ECS::Scheduler::Scheduler(EntityManager& em) : em(em)
+{
+    graphDirty = false;
+    systemsLeft = 0;
+    frameDt = 0;
+}
+
+void ECS::Scheduler::AddSystem(const std::string& name, const SystemAccess& access, std::function<void(EntityManager&, float)> update)
+{
+    systems.push_back({ name, access, update, {}, 0 });
+    graphDirty = true;
+}
+
+void ECS::Scheduler::BuildGraph()
+{
+    // A system waits on every earlier system it conflicts with, which keeps
+    // conflicting systems in the order they were added
+    for (int i = 0; i < (int)systems.size(); i++)
+    {
+        systems[i].dependents.clear();
+        systems[i].dependencyCount = 0;
+    }
+    for (int later = 0; later < (int)systems.size(); later++)
+    {
+        for (int earlier = 0; earlier < later; earlier++)
+        {
+            if (!systems[earlier].access.ConflictsWith(systems[later].access)) continue;
+            systems[earlier].dependents.push_back(later);
+            systems[later].dependencyCount++;
+        }
+    }
+
+    graphDirty = false;
+}
+
+void ECS::Scheduler::Run(float dt)
+{
+    if (graphDirty) BuildGraph();
+    if (systems.empty()) return;
+
+    frameDt = dt;
+    systemsLeft = (int)systems.size();
+    waitingOn.resize(systems.size());
+    for (int i = 0; i < (int)systems.size(); i++)
+    {
+        waitingOn[i] = systems[i].dependencyCount;
+    }
+    for (int i = 0; i < (int)systems.size(); i++)
+    {
+        if (systems[i].dependencyCount == 0) Dispatch(i);
+    }
+
+    // Help out until every system is done, taking the main thread's systems first
+    JobSystem& jobSystem = JobSystem::GetInstance();
+    while (systemsLeft.load(std::memory_order_acquire) > 0)
+    {
+        int system = -1;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!mainThreadReady.empty())
+            {
+                system = mainThreadReady.front();
+                mainThreadReady.pop_front();
+            }
+        }
+
+        if (system >= 0) Execute(system);
+        else if (!jobSystem.RunPendingJob()) std::this_thread::yield();
+    }
+}
+
+void ECS::Scheduler::Dispatch(int system)
+{
+    if (systems[system].access.mainThread)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        mainThreadReady.push_back(system);
+        return;
+    }
+
+    JobSystem::GetInstance().Run([this, system]() { Execute(system); });
+}
+
+void ECS::Scheduler::Execute(int system)
+{
+#ifdef _DEBUG
+    // A system waiting on jobs can end up running another system on this thread
+    const SystemAccess* outerAccess = runningAccess;
+    runningAccess = &systems[system].access;
+#endif
+    systems[system].update(em, frameDt);
+#ifdef _DEBUG
+    runningAccess = outerAccess;
+#endif
+
+    // Dispatch takes the lock itself for main thread systems
+    std::vector<int> unblocked;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int dependent : systems[system].dependents)
+        {
+            if (--waitingOn[dependent] == 0) unblocked.push_back(dependent);
+        }
+    }
+    for (int dependent : unblocked) Dispatch(dependent);
+
+    systemsLeft.fetch_sub(1, std::memory_order_release);
+}
\ No newline at end of file
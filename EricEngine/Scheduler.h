@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include "SystemAccess.h"
+
+namespace ECS
+{
+    class EntityManager;
+
+    // Runs a frame's systems as jobs on the JobSystem. Each system declares the components it
+    // reads and writes, and systems that conflict always run in the order they were added,
+    // so a frame gives the same results however the threads are timed. Systems that don't
+    // conflict run at the same time. Every system is handed the EntityManager the scheduler runs
+    // on, so the same systems can run on several worlds with a scheduler each.
+    //
+    // Systems must not make structural changes (creating and destroying entities, adding and
+    // removing components) directly, they record them in a CommandBuffer instead.
+    class Scheduler
+    {
+    public:
+        Scheduler(EntityManager& em);
+
+        void AddSystem(const std::string& name, const SystemAccess& access, std::function<void(EntityManager&, float)> update);
+
+        // Runs every system once and returns when all of them are done
+        void Run(float dt);
+
+    private:
+        struct System
+        {
+            std::string name;
+            SystemAccess access;
+            std::function<void(EntityManager&, float)> update;
+            // Systems that have to wait for this one
+            std::vector<int> dependents;
+            int dependencyCount;
+        };
+
+        EntityManager& em;
+        std::vector<System> systems;
+        // The dependency graph is rebuilt on the next Run after systems are added
+        bool graphDirty;
+
+        // State of the current Run
+        std::mutex mutex;
+        // Main thread systems whose dependencies are done, in the order they were added. Guarded by mutex
+        std::deque<int> mainThreadReady;
+        // Accessed like waitingOn[systemIndex], how many of its dependencies haven't finished. Guarded by mutex
+        std::vector<int> waitingOn;
+        std::atomic<int> systemsLeft;
+        float frameDt;
+
+        void BuildGraph();
+        // Queues a system whose dependencies are done as a job, or for the main thread
+        void Dispatch(int system);
+        // Runs system, then dispatches any dependents it was the last thing holding up
+        void Execute(int system);
+    };
+}
\ No newline at end of file
@@ -0,0 +1,8 @@
+#pragma once
+
+// Marks an entity that doesn't move. TransformSystem bakes its matrices and world bounds once
+// and leaves it out of every update after that, moving it costs a rebake of every static entity.
+// Its parents should be static too, a moving parent doesn't rebake it
+struct Static
+{
+};
\ No newline at end of file
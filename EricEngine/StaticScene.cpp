@@ -0,0 +1,113 @@
+#include "StaticScene.h"
+#include <algorithm>
+#include <cmath>
+
+// Bits per axis of the Morton code, 3 * 10 fits in 32 bits
+#define MORTON_BITS 10
+
+// Spreads the low 10 bits of v out so there are two zero bits between each
+static uint32_t SpreadBits(uint32_t v)
+{
+    v = (v | (v << 16)) & 0x030000FF;
+    v = (v | (v << 8)) & 0x0300F00F;
+    v = (v | (v << 4)) & 0x030C30C3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+static void Grow(StaticScene::Bounds& into, const StaticScene::Bounds& other)
+{
+    for (int axis = 0; axis < 3; axis++)
+    {
+        into.min[axis] = (std::min)(into.min[axis], other.min[axis]);
+        into.max[axis] = (std::max)(into.max[axis], other.max[axis]);
+    }
+}
+
+// Slab test, true if the ray hits the box at or after its origin
+static bool RayHitsBounds(const StaticScene::Bounds& box, const float* origin, const float* inverseDirection)
+{
+    float nearest = 0;
+    float farthest = INFINITY;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        float t1 = (box.min[axis] - origin[axis]) * inverseDirection[axis];
+        float t2 = (box.max[axis] - origin[axis]) * inverseDirection[axis];
+        nearest = (std::max)(nearest, (std::min)(t1, t2));
+        farthest = (std::min)(farthest, (std::max)(t1, t2));
+    }
+    return nearest <= farthest;
+}
+
+void StaticScene::Clear()
+{
+    entities.clear();
+    bounds.clear();
+    groupBounds.clear();
+}
+
+void StaticScene::Add(ECS::Entity entity, const Bounds& entityBounds)
+{
+    entities.push_back(entity);
+    bounds.push_back(entityBounds);
+}
+
+void StaticScene::Build()
+{
+    bakeCount++;
+    if (entities.empty()) return;
+
+    Bounds all = bounds[0];
+    for (const Bounds& b : bounds) Grow(all, b);
+
+    // Morton code of each entity's center within the scene's bounds
+    const float cells = (float)((1 << MORTON_BITS) - 1);
+    std::vector<std::pair<uint32_t, int>> keys(entities.size());
+    for (int i = 0; i < (int)entities.size(); i++)
+    {
+        uint32_t code = 0;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float extent = all.max[axis] - all.min[axis];
+            float center = (bounds[i].min[axis] + bounds[i].max[axis]) * 0.5f;
+            float t = extent > 0 ? (center - all.min[axis]) / extent : 0;
+            code |= SpreadBits((uint32_t)(t * cells)) << axis;
+        }
+        keys[i] = { code, i };
+    }
+    // Ties keep the order entities were added in, so a bake is repeatable
+    std::stable_sort(keys.begin(), keys.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    std::vector<ECS::Entity> sortedEntities(entities.size());
+    std::vector<Bounds> sortedBounds(bounds.size());
+    for (int i = 0; i < (int)keys.size(); i++)
+    {
+        sortedEntities[i] = entities[keys[i].second];
+        sortedBounds[i] = bounds[keys[i].second];
+    }
+    entities.swap(sortedEntities);
+    bounds.swap(sortedBounds);
+
+    for (int i = 0; i < (int)bounds.size(); i++)
+    {
+        if (i % STATIC_GROUP_SIZE == 0) groupBounds.push_back(bounds[i]);
+        else Grow(groupBounds.back(), bounds[i]);
+    }
+}
+
+void StaticScene::Raycast(const float* origin, const float* direction, std::vector<ECS::Entity>& hits) const
+{
+    // Division by zero gives infinity, which the slab test handles
+    float inverseDirection[3] = { 1.0f / direction[0], 1.0f / direction[1], 1.0f / direction[2] };
+
+    for (int group = 0; group < (int)groupBounds.size(); group++)
+    {
+        if (!RayHitsBounds(groupBounds[group], origin, inverseDirection)) continue;
+
+        int last = (std::min)((group + 1) * STATIC_GROUP_SIZE, (int)entities.size());
+        for (int i = group * STATIC_GROUP_SIZE; i < last; i++)
+        {
+            if (RayHitsBounds(bounds[i], origin, inverseDirection)) hits.push_back(entities[i]);
+        }
+    }
+}
\ No newline at end of file
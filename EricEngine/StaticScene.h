@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "Entity.h"
+
+// Entities per group, a ray that misses a group's bounds skips all of them
+#define STATIC_GROUP_SIZE 32
+
+// World space bounds of every static entity with a mesh, baked by TransformSystem and then left
+// alone until a static entity changes. Entities are sorted along a Morton curve so each group of
+// STATIC_GROUP_SIZE is close together in space and its combined bounds stay tight
+class StaticScene
+{
+public:
+    struct Bounds
+    {
+        float min[3];
+        float max[3];
+    };
+
+    // Starts a new bake, forgetting every entity
+    void Clear();
+    void Add(ECS::Entity entity, const Bounds& bounds);
+    // Sorts and groups everything added since Clear
+    void Build();
+
+    // Appends every entity whose bounds the ray from origin along direction passes through
+    void Raycast(const float* origin, const float* direction, std::vector<ECS::Entity>& hits) const;
+
+    int Size() const { return (int)entities.size(); }
+
+    // How many times the scene has been baked, and how long the last bake took
+    int BakeCount() const { return bakeCount; }
+    double LastBakeMilliseconds() const { return lastBakeMilliseconds; }
+    void SetLastBakeMilliseconds(double milliseconds) { lastBakeMilliseconds = milliseconds; }
+
+private:
+    // Accessed like entities[i] and bounds[i], sorted after Build
+    std::vector<ECS::Entity> entities;
+    std::vector<Bounds> bounds;
+    // Accessed like groupBounds[i / STATIC_GROUP_SIZE], the bounds around that group of entities
+    std::vector<Bounds> groupBounds;
+
+    int bakeCount = 0;
+    double lastBakeMilliseconds = 0;
+};
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Components.h"
+
+namespace ECS
+{
+    // The component types a system reads and writes. The Scheduler runs two systems at
+    // the same time only if neither writes something the other touches.
+    //     SystemAccess().Read<Mesh, Camera>().Write<Transform>()
+    //
+    // A system that only touches some entities can say so, and then it doesn't conflict with
+    // systems that touch none of those entities, even on the same component types:
+    //     SystemAccess().Write<Camera, Transform>().OnlyWith<Camera>()
+    //     SystemAccess().Write<Transform>().OnlyWithout<Camera>()
+    // Structural changes wait for FlushCommands, so entities can't move between the two during a
+    // frame. Change logs are shared by every entity in a pool though, so a limited system can't
+    // MarkChanged or GetComponentForWrite.
+    struct SystemAccess
+    {
+        Signature reads = 0;
+        Signature writes = 0;
+        // The entities the reads and writes are limited to: ones with every component in
+        // entitiesWith and none in entitiesWithout
+        Signature entitiesWith = 0;
+        Signature entitiesWithout = 0;
+        // Has to run on the thread that calls Scheduler::Run, e.g. for D3D calls
+        bool mainThread = false;
+
+        template <class... ComponentTypes>
+        SystemAccess& Read()
+        {
+            reads |= SignatureOf<ComponentTypes...>;
+            return *this;
+        }
+
+        template <class... ComponentTypes>
+        SystemAccess& Write()
+        {
+            writes |= SignatureOf<ComponentTypes...>;
+            return *this;
+        }
+
+        template <class... ComponentTypes>
+        SystemAccess& OnlyWith()
+        {
+            entitiesWith |= SignatureOf<ComponentTypes...>;
+            return *this;
+        }
+
+        template <class... ComponentTypes>
+        SystemAccess& OnlyWithout()
+        {
+            entitiesWithout |= SignatureOf<ComponentTypes...>;
+            return *this;
+        }
+
+        SystemAccess& OnMainThread()
+        {
+            mainThread = true;
+            return *this;
+        }
+
+        // True if no entity can be in both systems' sets
+        bool DisjointFrom(const SystemAccess& other) const
+        {
+            return (entitiesWith & other.entitiesWithout) != 0 || (other.entitiesWith & entitiesWithout) != 0;
+        }
+
+        bool ConflictsWith(const SystemAccess& other) const
+        {
+            if (DisjointFrom(other)) return false;
+            return (writes & (other.reads | other.writes)) != 0 || (other.writes & reads) != 0;
+        }
+    };
+
+#ifdef _DEBUG
+    // Asserts that the system running on this thread declared the access it's making.
+    // Threads that aren't running a scheduled system can access anything
+    void CheckSystemAccess(Signature components, bool write);
+    // Asserts that no scheduled system is running on this thread. Systems have to make
+    // structural changes through a CommandBuffer
+    void CheckStructuralChange();
+#endif
+}
+
+#ifdef _DEBUG
+#define ECS_CHECK_ACCESS(components, write) ECS::CheckSystemAccess(components, write)
+#define ECS_CHECK_STRUCTURAL_CHANGE() ECS::CheckStructuralChange()
+#else
+#define ECS_CHECK_ACCESS(components, write)
+#define ECS_CHECK_STRUCTURAL_CHANGE()
+#endif
\ No newline at end of file
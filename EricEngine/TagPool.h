@@ -0,0 +1,210 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include "ComponentPool.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace ECS
+{
+    // Index of the lowest set bit, bits can't be 0
+    inline int CountTrailingZeros(uint64_t bits)
+    {
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index;
+        _BitScanForward64(&index, bits);
+        return (int)index;
+#elif defined(_MSC_VER)
+        unsigned long index;
+        if (_BitScanForward(&index, (unsigned long)bits)) return (int)index;
+        _BitScanForward(&index, (unsigned long)(bits >> 32));
+        return (int)index + 32;
+#else
+        return __builtin_ctzll(bits);
+#endif
+    }
+
+    // Stores a tag, a component type with no data, as one bit per entity. Testing, adding
+    // and removing a tag is a bit operation, and tag queries AND whole 64 bit words so
+    // they test 64 entities at a time.
+    //
+    // Mirrors ComponentPool so the EntityManager can treat both the same way. Every entity
+    // shares the one empty TagType instance that Add and Get hand out.
+    template <class TagType>
+    class TagPool
+    {
+    private:
+        // Accessed like words[entityID / 64] >> (entityID % 64)
+        std::vector<uint64_t> words;
+        int count = 0;
+        // Times words has had to grow its allocation
+        int allocations = 0;
+
+        // Entities tagged since the last TakeEvents, as bits like words and as a list.
+        // Only kept once ResetEvents has been called, when something is observing the tag
+        bool tracking = false;
+        std::vector<uint64_t> fresh;
+        std::vector<int> freshList;
+
+        void MarkFresh(int entityID)
+        {
+            int word = entityID / 64;
+            if (word >= (int)fresh.size()) fresh.resize(word + 1, 0);
+            fresh[word] |= uint64_t(1) << (entityID % 64);
+            freshList.push_back(entityID);
+        }
+
+        bool IsFresh(int entityID) const
+        {
+            int word = entityID / 64;
+            return word < (int)fresh.size() && ((fresh[word] >> (entityID % 64)) & 1);
+        }
+
+        void Grow(int wordCount)
+        {
+            if (wordCount <= (int)words.size()) return;
+            if (wordCount > (int)words.capacity()) allocations++;
+            words.resize(wordCount, 0);
+        }
+
+        static TagType instance;
+
+    public:
+        using Type = TagType;
+
+        TagType* Add(int entityID, const TagType&, uint32_t)
+        {
+            int word = entityID / 64;
+            Grow(word + 1);
+            if (!Has(entityID))
+            {
+                count++;
+                if (tracking) MarkFresh(entityID);
+            }
+            words[word] |= uint64_t(1) << (entityID % 64);
+            return &instance;
+        }
+
+        void AddRange(const std::vector<int>& entityIDs, const TagType&, uint32_t)
+        {
+            if (entityIDs.empty()) return;
+
+            Grow(*std::max_element(entityIDs.begin(), entityIDs.end()) / 64 + 1);
+            for (int entityID : entityIDs)
+            {
+                words[entityID / 64] |= uint64_t(1) << (entityID % 64);
+                if (tracking) MarkFresh(entityID);
+            }
+            count += (int)entityIDs.size();
+        }
+
+        // Moves every tag into target, where it belongs to entity remap[entityID], and empties this pool.
+        // Tags whose remap entry is INVALID_INDEX are dropped
+        void MoveInto(TagPool& target, const std::vector<int>& remap, uint32_t tick)
+        {
+            ForEach([&](int entityID, const TagType& tag) {
+                if (remap[entityID] != INVALID_INDEX) target.Add(remap[entityID], tag, tick);
+            });
+            words.clear();
+            fresh.clear();
+            freshList.clear();
+            count = 0;
+        }
+
+        // Returns nullptr if the entity doesn't have this tag
+        TagType* Get(int entityID) { return Has(entityID) ? &instance : nullptr; }
+
+        bool Has(int entityID) const
+        {
+            int word = entityID / 64;
+            return word < (int)words.size() && ((words[word] >> (entityID % 64)) & 1);
+        }
+
+        void Remove(int entityID)
+        {
+            if (!Has(entityID)) return;
+            words[entityID / 64] &= ~(uint64_t(1) << (entityID % 64));
+            if (IsFresh(entityID)) fresh[entityID / 64] &= ~(uint64_t(1) << (entityID % 64));
+            count--;
+        }
+
+        int Size() const { return count; }
+
+        // How many entity slots the bitset covers before it has to grow
+        int Capacity() const { return (int)words.capacity() * 64; }
+
+        size_t BytesUsed() const
+        {
+            return (words.size() + fresh.size()) * sizeof(uint64_t) + freshList.size() * sizeof(int);
+        }
+        size_t BytesReserved() const
+        {
+            return (words.capacity() + fresh.capacity()) * sizeof(uint64_t) + freshList.capacity() * sizeof(int);
+        }
+
+        int Allocations() const { return allocations; }
+
+        // One bit per entity slot, for word at a time queries
+        const std::vector<uint64_t>& Words() const { return words; }
+
+        // Tags have no data to change, so there's nothing to log
+        void MarkChanged(int, uint32_t) {}
+        void TrimLogs(uint32_t) {}
+
+        // Appends the entities tagged since the last call that still have the tag to added.
+        // Tags never change, so changed is left alone
+        void TakeEvents(std::vector<int>& added, std::vector<int>&)
+        {
+            for (int entityID : freshList)
+            {
+                if (!IsFresh(entityID)) continue;
+                added.push_back(entityID);
+                fresh[entityID / 64] &= ~(uint64_t(1) << (entityID % 64));
+            }
+            freshList.clear();
+        }
+
+        // Starts tracking new tags, TakeEvents reports from here on
+        void ResetEvents()
+        {
+            tracking = true;
+            for (int entityID : freshList) fresh[entityID / 64] = 0;
+            freshList.clear();
+        }
+
+        bool AddedSinceEvents(int entityID) const { return IsFresh(entityID); }
+
+        // Calls func(entityID, tag) for every entity with the tag, in entity order
+        template <class Func>
+        void ForEach(Func func);
+    };
+
+    template<class TagType>
+    TagType TagPool<TagType>::instance;
+
+    template<class TagType>
+    template<class Func>
+    inline void TagPool<TagType>::ForEach(Func func)
+    {
+        for (int w = 0; w < (int)words.size(); w++)
+        {
+            for (uint64_t bits = words[w]; bits != 0; bits &= bits - 1)
+            {
+                func(w * 64 + CountTrailingZeros(bits), instance);
+            }
+        }
+    }
+
+    // Empty component types are stored as tags
+    template <class ComponentType>
+    constexpr bool IsTag = std::is_empty<ComponentType>::value;
+
+    // The pool a component type is stored in
+    template <class ComponentType>
+    using PoolFor = std::conditional_t<IsTag<ComponentType>, TagPool<ComponentType>, ComponentPool<ComponentType>>;
+}
\ No newline at end of file
@@ -2,8 +2,6 @@
 
 using namespace DirectX;
 
-int Transform::id;
-
 Transform::Transform()
 {
     position = XMFLOAT3(0, 0, 0);
@@ -13,10 +11,8 @@ Transform::Transform()
     XMMATRIX ident = XMMatrixIdentity();
     XMStoreFloat4x4(&worldMatrix, ident);
     XMStoreFloat4x4(&worldInverseTransposeMatrix, ident);
+    XMStoreFloat4x4(&worldInverseMatrix, ident);
+    rotation = XMFLOAT4(0, 0, 0, 1);
 
     matricesDirty = false;
 }
-
-Transform::~Transform()
-{
-}
\ No newline at end of file
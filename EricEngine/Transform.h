@@ -1,8 +1,7 @@
 #pragma once
 #include <DirectXMath.h>
-#include "EntityManager.h"
 
-struct Transform : ECS::Component
+struct Transform
 {
 public:
     DirectX::XMFLOAT3 position;
@@ -10,17 +9,15 @@ public:
     DirectX::XMFLOAT3 scale;
     DirectX::XMFLOAT4X4 worldMatrix;
     DirectX::XMFLOAT4X4 worldInverseTransposeMatrix;
+    // Kept up to date by TransformSystem with the matrices, so nobody has to invert worldMatrix
+    DirectX::XMFLOAT4X4 worldInverseMatrix;
+    // pitchYawRoll as a quaternion, also kept up to date by TransformSystem. Like the matrices,
+    // only current while matricesDirty is false
+    DirectX::XMFLOAT4 rotation;
     bool matricesDirty;
     DirectX::XMFLOAT3 up;
     DirectX::XMFLOAT3 right;
     DirectX::XMFLOAT3 forward;
 
     Transform();
-    virtual ~Transform();
-
-    static int id;
-    virtual int ID()
-    {
-        return id;
-    }
 };
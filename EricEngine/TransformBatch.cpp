@@ -0,0 +1,210 @@
+#include "TransformBatch.h"
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+int TransformBatch::Add(const float* position, const float* pitchYawRoll, const float* scale)
+{
+    columns[PositionX].push_back(position[0]);
+    columns[PositionY].push_back(position[1]);
+    columns[PositionZ].push_back(position[2]);
+    columns[ScaleX].push_back(scale[0]);
+    columns[ScaleY].push_back(scale[1]);
+    columns[ScaleZ].push_back(scale[2]);
+    columns[Pitch].push_back(pitchYawRoll[0]);
+    columns[Yaw].push_back(pitchYawRoll[1]);
+    columns[Roll].push_back(pitchYawRoll[2]);
+
+    return count++;
+}
+
+void TransformBatch::Clear()
+{
+    // Keeps the memory for the next frame
+    for (auto& column : columns) column.clear();
+    count = 0;
+}
+
+void TransformBatch::PrepareOutputs()
+{
+    for (int column = SinPitch; column < ColumnCount; column++) columns[column].resize(count);
+}
+
+void TransformBatch::Compose()
+{
+    PrepareOutputs();
+    Compose(0, count);
+}
+
+void TransformBatch::Compose(int first, int last)
+{
+    ComputeAngles(first, last);
+
+    int i = first;
+#if defined(__AVX2__)
+    // Same math as ComposeScalar, 8 transforms per register
+    auto load = [&](Column column) { return _mm256_loadu_ps(columns[column].data() + i); };
+    auto store = [&](Column column, __m256 value) { _mm256_storeu_ps(columns[column].data() + i, value); };
+    __m256 one = _mm256_set1_ps(1.0f);
+
+    for (; i + 8 <= last; i += 8)
+    {
+        __m256 sp = load(SinPitch), cp = load(CosPitch);
+        __m256 sy = load(SinYaw), cy = load(CosYaw);
+        __m256 sr = load(SinRoll), cr = load(CosRoll);
+
+        __m256 srsp = _mm256_mul_ps(sr, sp);
+        __m256 crsp = _mm256_mul_ps(cr, sp);
+        __m256 rotation[3][3] = {
+            { _mm256_add_ps(_mm256_mul_ps(cr, cy), _mm256_mul_ps(srsp, sy)), _mm256_mul_ps(sr, cp), _mm256_sub_ps(_mm256_mul_ps(srsp, cy), _mm256_mul_ps(cr, sy)) },
+            { _mm256_sub_ps(_mm256_mul_ps(crsp, sy), _mm256_mul_ps(sr, cy)), _mm256_mul_ps(cr, cp), _mm256_add_ps(_mm256_mul_ps(sr, sy), _mm256_mul_ps(crsp, cy)) },
+            { _mm256_mul_ps(cp, sy), _mm256_sub_ps(_mm256_setzero_ps(), sp), _mm256_mul_ps(cp, cy) }
+        };
+        __m256 scale[3] = { load(ScaleX), load(ScaleY), load(ScaleZ) };
+        __m256 position[3] = { load(PositionX), load(PositionY), load(PositionZ) };
+
+        for (int row = 0; row < 3; row++)
+        {
+            __m256 inverseScale = _mm256_div_ps(one, scale[row]);
+            __m256 dot = _mm256_setzero_ps();
+            for (int col = 0; col < 3; col++)
+            {
+                store(Column(Rotation00 + row * 3 + col), rotation[row][col]);
+                store(Column(World00 + row * 3 + col), _mm256_mul_ps(rotation[row][col], scale[row]));
+                store(Column(Inverse00 + row * 3 + col), _mm256_mul_ps(rotation[row][col], inverseScale));
+                dot = _mm256_add_ps(dot, _mm256_mul_ps(rotation[row][col], position[col]));
+            }
+            store(Column(Inverse03 + row), _mm256_sub_ps(_mm256_setzero_ps(), _mm256_mul_ps(dot, inverseScale)));
+        }
+    }
+#endif
+
+    // Whatever didn't fill a whole register, its angles were computed above
+    ComposeFromAngles(i, last);
+}
+
+void TransformBatch::ComputeAngles(int first, int last)
+{
+    for (int i = first; i < last; i++)
+    {
+        // Trig on the half angles only, the full angles follow from sin 2a = 2 sin a cos a
+        // and cos 2a = cos^2 a - sin^2 a
+        float sp = std::sin(columns[Pitch][i] * 0.5f), cp = std::cos(columns[Pitch][i] * 0.5f);
+        float sy = std::sin(columns[Yaw][i] * 0.5f), cy = std::cos(columns[Yaw][i] * 0.5f);
+        float sr = std::sin(columns[Roll][i] * 0.5f), cr = std::cos(columns[Roll][i] * 0.5f);
+
+        columns[SinPitch][i] = 2 * sp * cp;
+        columns[CosPitch][i] = cp * cp - sp * sp;
+        columns[SinYaw][i] = 2 * sy * cy;
+        columns[CosYaw][i] = cy * cy - sy * sy;
+        columns[SinRoll][i] = 2 * sr * cr;
+        columns[CosRoll][i] = cr * cr - sr * sr;
+
+        // Matches XMQuaternionRotationRollPitchYaw
+        columns[QuaternionX][i] = sp * cy * cr + cp * sy * sr;
+        columns[QuaternionY][i] = cp * sy * cr - sp * cy * sr;
+        columns[QuaternionZ][i] = cp * cy * sr - sp * sy * cr;
+        columns[QuaternionW][i] = cp * cy * cr + sp * sy * sr;
+    }
+}
+
+void TransformBatch::ComposeScalar(int first, int last)
+{
+    ComputeAngles(first, last);
+    ComposeFromAngles(first, last);
+}
+
+void TransformBatch::ComposeFromAngles(int first, int last)
+{
+    for (int i = first; i < last; i++)
+    {
+        float sp = columns[SinPitch][i], cp = columns[CosPitch][i];
+        float sy = columns[SinYaw][i], cy = columns[CosYaw][i];
+        float sr = columns[SinRoll][i], cr = columns[CosRoll][i];
+
+        // Roll, then pitch, then yaw, the same rotation XMMatrixRotationRollPitchYaw makes
+        float rotation[3][3] = {
+            { cr * cy + sr * sp * sy, sr * cp, sr * sp * cy - cr * sy },
+            { cr * sp * sy - sr * cy, cr * cp, sr * sy + cr * sp * cy },
+            { cp * sy, -sp, cp * cy }
+        };
+        float scale[3] = { columns[ScaleX][i], columns[ScaleY][i], columns[ScaleZ][i] };
+        float position[3] = { columns[PositionX][i], columns[PositionY][i], columns[PositionZ][i] };
+
+        // World is scale * rotation * translation, so row r of the rotation is scaled by scale[r].
+        // Its inverse transpose is the rotation with each row divided by the scale instead, and
+        // a last column that undoes the translation. No general 4x4 inverse needed
+        for (int row = 0; row < 3; row++)
+        {
+            float inverseScale = 1.0f / scale[row];
+            float dot = 0;
+            for (int col = 0; col < 3; col++)
+            {
+                columns[Rotation00 + row * 3 + col][i] = rotation[row][col];
+                columns[World00 + row * 3 + col][i] = rotation[row][col] * scale[row];
+                columns[Inverse00 + row * 3 + col][i] = rotation[row][col] * inverseScale;
+                dot += rotation[row][col] * position[col];
+            }
+            columns[Inverse03 + row][i] = -(dot * inverseScale);
+        }
+    }
+}
+
+void TransformBatch::GetWorldMatrix(int slot, float* matrix) const
+{
+    for (int row = 0; row < 3; row++)
+    {
+        for (int col = 0; col < 3; col++) matrix[row * 4 + col] = columns[World00 + row * 3 + col][slot];
+        matrix[row * 4 + 3] = 0;
+    }
+    matrix[12] = columns[PositionX][slot];
+    matrix[13] = columns[PositionY][slot];
+    matrix[14] = columns[PositionZ][slot];
+    matrix[15] = 1;
+}
+
+void TransformBatch::GetWorldInverseTransposeMatrix(int slot, float* matrix) const
+{
+    for (int row = 0; row < 3; row++)
+    {
+        for (int col = 0; col < 3; col++) matrix[row * 4 + col] = columns[Inverse00 + row * 3 + col][slot];
+        matrix[row * 4 + 3] = columns[Inverse03 + row][slot];
+    }
+    matrix[12] = 0;
+    matrix[13] = 0;
+    matrix[14] = 0;
+    matrix[15] = 1;
+}
+
+void TransformBatch::GetWorldInverseMatrix(int slot, float* matrix) const
+{
+    // The transpose of the inverse transpose
+    for (int row = 0; row < 3; row++)
+    {
+        for (int col = 0; col < 3; col++) matrix[row * 4 + col] = columns[Inverse00 + col * 3 + row][slot];
+        matrix[row * 4 + 3] = 0;
+    }
+    matrix[12] = columns[Inverse03][slot];
+    matrix[13] = columns[Inverse13][slot];
+    matrix[14] = columns[Inverse23][slot];
+    matrix[15] = 1;
+}
+
+void TransformBatch::GetRotation(int slot, float* quaternion) const
+{
+    quaternion[0] = columns[QuaternionX][slot];
+    quaternion[1] = columns[QuaternionY][slot];
+    quaternion[2] = columns[QuaternionZ][slot];
+    quaternion[3] = columns[QuaternionW][slot];
+}
+
+void TransformBatch::GetBasis(int slot, float* right, float* up, float* forward) const
+{
+    float* rows[3] = { right, up, forward };
+    for (int row = 0; row < 3; row++)
+    {
+        for (int col = 0; col < 3; col++) rows[row][col] = columns[Rotation00 + row * 3 + col][slot];
+    }
+}
\ No newline at end of file
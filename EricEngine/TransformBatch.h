@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+
+// Transforms waiting for their matrices to be rebuilt, stored a column per field instead of a
+// struct per transform, so the composition kernel can work on a whole register of them at once.
+// TransformSystem gathers dirty transforms in with Add, calls Compose, and copies results back out
+class TransformBatch
+{
+public:
+    // Appends a transform and returns its slot in the batch. Each argument points at x, y and z
+    int Add(const float* position, const float* pitchYawRoll, const float* scale);
+
+    void Clear();
+    int Size() const { return count; }
+
+    // Builds every transform's world matrix, inverse transpose and basis vectors. Runs 8 transforms
+    // per iteration when built with AVX2, and the rest one at a time
+    void Compose();
+
+    // Sizes the outputs for every slot added so far. Call it once after the last Add before
+    // composing ranges, Compose() does it itself
+    void PrepareOutputs();
+    // Compose for slots [first, last). Ranges that don't overlap can be composed on different threads.
+    // Ranges starting at multiples of 8 run every slot down the same path Compose() does, so they
+    // give exactly the same results
+    void Compose(int first, int last);
+    // Compose with the one at a time path only
+    void ComposeScalar(int first, int last);
+
+    // Row major 4x4 matrices, like XMFLOAT4X4
+    void GetWorldMatrix(int slot, float* matrix) const;
+    void GetWorldInverseTransposeMatrix(int slot, float* matrix) const;
+    void GetWorldInverseMatrix(int slot, float* matrix) const;
+    // The rotation as a quaternion, x, y, z then w like XMFLOAT4
+    void GetRotation(int slot, float* quaternion) const;
+    // The rows of the rotation, so the local x, y and z axes in world space
+    void GetBasis(int slot, float* right, float* up, float* forward) const;
+
+private:
+    enum Column
+    {
+        // Inputs
+        PositionX, PositionY, PositionZ,
+        ScaleX, ScaleY, ScaleZ,
+        Pitch, Yaw, Roll,
+        // The sines and cosines of the angles, worked out first since AVX2 has no trig instructions
+        SinPitch, CosPitch, SinYaw, CosYaw, SinRoll, CosRoll,
+        // The same rotation as a quaternion, which falls out of the half angles' sines and cosines
+        QuaternionX, QuaternionY, QuaternionZ, QuaternionW,
+        // Rotation matrix, row major. Its rows are the basis vectors
+        Rotation00, Rotation01, Rotation02,
+        Rotation10, Rotation11, Rotation12,
+        Rotation20, Rotation21, Rotation22,
+        // The upper 3x3 of the world matrix, the rest comes from position
+        World00, World01, World02,
+        World10, World11, World12,
+        World20, World21, World22,
+        // The upper 3x3 of the inverse transpose, and its last column
+        Inverse00, Inverse01, Inverse02,
+        Inverse10, Inverse11, Inverse12,
+        Inverse20, Inverse21, Inverse22,
+        Inverse03, Inverse13, Inverse23,
+        ColumnCount
+    };
+
+    // Accessed like columns[column][slot]
+    std::vector<float> columns[ColumnCount];
+    int count = 0;
+
+    // Fills the sine, cosine and quaternion columns for slots [first, last)
+    void ComputeAngles(int first, int last);
+    // The one at a time path for slots [first, last) whose angles are already computed
+    void ComposeFromAngles(int first, int last);
+};
\ No newline at end of file
@@ -1,95 +1,347 @@
 #include "TransformSystem.h"
 #include "EntityManager.h"
+#include "Mesh.h"
+#include "Camera.h"
 #include <DirectXMath.h>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
 
 using namespace ECS;
 using namespace DirectX;
 
-TransformSystem::TransformSystem()
+TransformSystem::TransformSystem(EntityManager& em)
 {
+    lastUpdateTick = 0;
+    updateCount = 0;
+    parallelThreshold = TRANSFORM_PARALLEL_THRESHOLD;
+    builtParentCount = 0;
+    observed = &em;
+
+    // Anything made static before now is baked on the first update
+    staticsChanged = true;
+    auto onStaticChanged = [this](const std::vector<Entity>&) { staticsChanged = true; };
+    observers.push_back(em.OnAdd<Static>(onStaticChanged));
+    observers.push_back(em.OnRemove<Static>(onStaticChanged));
+
+    // A static entity's mesh decides its bounds
+    auto onMeshChanged = [this](const std::vector<Entity>& entities) {
+        for (Entity e : entities)
+        {
+            if (observed->HasComponent<Static>(e)) staticsChanged = true;
+        }
+    };
+    observers.push_back(em.OnAdd<Mesh>(onMeshChanged));
+    observers.push_back(em.OnRemove<Mesh>(onMeshChanged));
+    observers.push_back(em.OnChange<Mesh>(onMeshChanged));
+}
+
+TransformSystem::~TransformSystem()
+{
+    for (ObserverID id : observers) observed->RemoveObserver(id);
 }
 
-void TransformSystem::CalculateUp(Transform* transform)
+void TransformSystem::Update(EntityManager& em, float dt)
 {
-    // Take the world up vector and rotate it by out own rotation values
-    XMVECTOR localUp = XMVector3Rotate(
-        XMVectorSet(0, 1, 0, 0),
-        XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&transform->pitchYawRoll)));
+    assert(&em == observed && "TransformSystem updates the EntityManager it was made for");
 
-    XMStoreFloat3(&transform->up, localUp);
+    // Only visit transforms touched since the last update. Anything changed later this
+    // tick, after we've run, is picked up next time. Cameras are left to CameraControl
+    uint32_t since = lastUpdateTick;
+    lastUpdateTick = em.GetTick();
+    updateCount++;
+    movedStamp.resize(em.GetSlotCount(), 0);
+    queuedStamp.resize(em.GetSlotCount(), 0);
+
+    batch.Clear();
+    dirty.clear();
+
+    // Static transforms are left alone until one of them changes, then every one is rebaked.
+    // Checked before the hierarchy queues anything, since queueing marks transforms clean
+    for (auto [e, t, isStatic] : em.GetView<Transform, Static>(Changed<Transform>(since), Without<Camera>()))
+    {
+        if (!t.matricesDirty) continue;
+        staticsChanged = true;
+        break;
+    }
+
+    UpdateHierarchy(em, since);
+    bool bake = staticsChanged;
+    if (bake)
+    {
+        for (auto [e, t, isStatic] : em.GetView<Transform, Static>(Without<Camera>())) Queue(&t, e.Index());
+    }
+
+    for (auto [e, t] : em.GetView<Transform>(Changed<Transform>(since), Without<Static, Camera>()))
+    {
+        if (t.matricesDirty) Queue(&t, e.Index());
+    }
+
+    // Matrices and basis vectors for the whole batch at once, then copied back. Every slot
+    // belongs to one transform, so jobs never write the same one
+    batch.PrepareOutputs();
+    int count = batch.Size();
+    bool parallel = count >= parallelThreshold;
+    JobSystem& jobSystem = JobSystem::GetInstance();
+    if (parallel)
+    {
+        JobCounter counter;
+        for (int first = 0; first < count; first += TRANSFORM_JOB_SIZE)
+        {
+            int last = (std::min)(first + TRANSFORM_JOB_SIZE, count);
+            jobSystem.Run([this, first, last]() { UpdateRange(first, last); }, &counter);
+        }
+        jobSystem.Wait(counter);
+    }
+    else
+    {
+        UpdateRange(0, count);
+    }
+
+    // Then children, a level at a time so parents are always done first. Nodes in one level
+    // never depend on each other, so a big level can be split into jobs. Those may run on a
+    // thread busy with another system, so they get the pool up front rather than going through
+    // the access checked EntityManager calls
+    auto& transforms = em.GetComponentPool<Transform>();
+    parallel = (int)nodes.size() >= parallelThreshold;
+    for (int level = 0; level + 1 < (int)levelStarts.size(); level++)
+    {
+        int levelFirst = levelStarts[level];
+        int levelLast = levelStarts[level + 1];
+        if (!parallel || levelLast - levelFirst <= TRANSFORM_JOB_SIZE)
+        {
+            PropagateRange(em, transforms, levelFirst, levelLast);
+            continue;
+        }
+
+        JobCounter counter;
+        for (int first = levelFirst; first < levelLast; first += TRANSFORM_JOB_SIZE)
+        {
+            int last = (std::min)(first + TRANSFORM_JOB_SIZE, levelLast);
+            jobSystem.Run([this, &em, &transforms, first, last]() { PropagateRange(em, transforms, first, last); }, &counter);
+        }
+        jobSystem.Wait(counter);
+    }
+
+    // Bounds are taken from the finished world matrices
+    if (bake)
+    {
+        auto bakeStart = std::chrono::high_resolution_clock::now();
+        BakeStaticScene(em);
+        staticScene.SetLastBakeMilliseconds(std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - bakeStart).count());
+    }
 }
 
-void TransformSystem::CalculateRight(Transform* transform)
+void TransformSystem::Queue(Transform* transform, uint32_t entityIndex)
 {
-    // Take the world right vector and rotate it by out own rotation values
-    XMVECTOR localRight = XMVector3Rotate(
-        XMVectorSet(1, 0, 0, 0),
-        XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&transform->pitchYawRoll)));
+    // One slot per transform, or two jobs could write the same one
+    if (queuedStamp[entityIndex] == updateCount) return;
+    queuedStamp[entityIndex] = updateCount;
 
-    XMStoreFloat3(&transform->right, localRight);
+    int node = entityIndex < nodeOf.size() ? nodeOf[entityIndex] : INVALID_INDEX;
+    batch.Add(&transform->position.x, &transform->pitchYawRoll.x, &transform->scale.x);
+    dirty.push_back({ transform, entityIndex, node });
+    transform->matricesDirty = false;
 }
 
-void TransformSystem::CalculateForward(Transform* transform)
+void TransformSystem::UpdateRange(int first, int last)
 {
-    // Take the world forward vector and rotate it by out own rotation values
-    XMVECTOR localForward = XMVector3Rotate(
-        XMVectorSet(0, 0, 1, 0),
-        XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&transform->pitchYawRoll)));
+    batch.Compose(first, last);
+    for (int slot = first; slot < last; slot++)
+    {
+        DirtyTransform& d = dirty[slot];
+        if (d.node != INVALID_INDEX)
+        {
+            // A child's matrices are relative to its parent, PropagateRange makes world ones
+            HierarchyNode& node = nodes[d.node];
+            batch.GetWorldMatrix(slot, &node.localMatrix.m[0][0]);
+            batch.GetWorldInverseTransposeMatrix(slot, &node.localInverseTransposeMatrix.m[0][0]);
+            batch.GetRotation(slot, &d.transform->rotation.x);
+            node.composed = updateCount;
+            continue;
+        }
 
-    XMStoreFloat3(&transform->forward, localForward);
+        Transform* t = d.transform;
+        batch.GetWorldMatrix(slot, &t->worldMatrix.m[0][0]);
+        batch.GetWorldInverseTransposeMatrix(slot, &t->worldInverseTransposeMatrix.m[0][0]);
+        batch.GetWorldInverseMatrix(slot, &t->worldInverseMatrix.m[0][0]);
+        batch.GetRotation(slot, &t->rotation.x);
+        batch.GetBasis(slot, &t->right.x, &t->up.x, &t->forward.x);
+        movedStamp[d.entityIndex] = updateCount;
+    }
 }
 
-void TransformSystem::UpdateMatrices(Transform* transform)
+void TransformSystem::PropagateRange(const EntityManager& em, ComponentPool<Transform>& transforms, int first, int last)
 {
-    // update the matrices by creating the individual transformation 
-    // matrices and combining
-    XMMATRIX transMat = XMMatrixTranslation(
-        transform->position.x,
-        transform->position.y,
-        transform->position.z);
-    XMMATRIX rotMat = XMMatrixRotationRollPitchYaw(
-        transform->pitchYawRoll.x,
-        transform->pitchYawRoll.y,
-        transform->pitchYawRoll.z);
-    XMMATRIX scaleMat = XMMatrixScaling(
-        transform->scale.x,
-        transform->scale.y,
-        transform->scale.z);
-
-    // Combine into a single matrix that represents all transformations
-    // and store the results
-    XMMATRIX worldMat = scaleMat * rotMat * transMat; // SRT
-    XMStoreFloat4x4(&transform->worldMatrix, worldMat);
-
-    // While we're at it, create the inverse transpose matrix
-    XMStoreFloat4x4(
-        &transform->worldInverseTransposeMatrix,
-        XMMatrixInverse(0, XMMatrixTranspose(worldMat))
-    );
-
-
-    // Clean once again!
-    transform->matricesDirty = false;
+    for (int i = first; i < last; i++)
+    {
+        HierarchyNode& node = nodes[i];
+        // Only subtrees under something that moved are visited past this check
+        if (node.composed != updateCount && movedStamp[node.parent.Index()] != updateCount) continue;
+
+        Transform* t = em.IsAlive(node.entity) ? transforms.Get(node.entity.Index()) : nullptr;
+        if (t == nullptr) continue;
+
+        XMMATRIX world = XMLoadFloat4x4(&node.localMatrix);
+        XMMATRIX worldInverseTranspose = XMLoadFloat4x4(&node.localInverseTransposeMatrix);
+        // A parent without a transform, or one that's gone, leaves the child where its local matrix puts it
+        Transform* parent = em.IsAlive(node.parent) ? transforms.Get(node.parent.Index()) : nullptr;
+        if (parent != nullptr)
+        {
+            world = world * XMLoadFloat4x4(&parent->worldMatrix);
+            // (local * parent)^-T is local^-T * parent^-T
+            worldInverseTranspose = worldInverseTranspose * XMLoadFloat4x4(&parent->worldInverseTransposeMatrix);
+        }
+        XMStoreFloat4x4(&t->worldMatrix, world);
+        XMStoreFloat4x4(&t->worldInverseTransposeMatrix, worldInverseTranspose);
+        XMStoreFloat4x4(&t->worldInverseMatrix, XMMatrixTranspose(worldInverseTranspose));
+
+        // The world matrix rows are the axes, scaled, so the basis follows the parent's rotation too
+        XMStoreFloat3(&t->right, XMVector3Normalize(world.r[0]));
+        XMStoreFloat3(&t->up, XMVector3Normalize(world.r[1]));
+        XMStoreFloat3(&t->forward, XMVector3Normalize(world.r[2]));
+
+        movedStamp[node.entity.Index()] = updateCount;
+    }
+}
+
+void TransformSystem::UpdateHierarchy(EntityManager& em, uint32_t since)
+{
+    // Added parents are logged as changed too, removed ones show up in the pool size
+    auto& parents = em.GetComponentPool<Parent>();
+    auto changed = em.GetView<Parent>(Changed<Parent>(since));
+    if (parents.Size() == builtParentCount && changed.begin() == changed.end()) return;
+
+    // Former children may be roots now, or under someone else
+    std::vector<Entity> affected;
+    for (const HierarchyNode& node : nodes) affected.push_back(node.entity);
+
+    int slotCount = em.GetSlotCount();
+    depths.assign(slotCount, INVALID_INDEX);
+    nodes.clear();
+    for (auto [e, parent] : em.GetView<Parent>())
+    {
+        if (!em.HasComponent<Camera>(e) && DepthOf(em, e) > 0) nodes.push_back({ e, parent.entity });
+    }
+
+    // Children of one parent keep their pool order, so the result doesn't depend on timing
+    std::stable_sort(nodes.begin(), nodes.end(), [&](const HierarchyNode& a, const HierarchyNode& b) {
+        return depths[a.entity.Index()] < depths[b.entity.Index()];
+    });
+
+    levelStarts.clear();
+    nodeOf.assign(slotCount, INVALID_INDEX);
+    for (int i = 0; i < (int)nodes.size(); i++)
+    {
+        uint32_t index = nodes[i].entity.Index();
+        nodeOf[index] = i;
+        if (i == 0 || depths[index] != depths[nodes[i - 1].entity.Index()]) levelStarts.push_back(i);
+    }
+    levelStarts.push_back((int)nodes.size());
+    builtParentCount = parents.Size();
+
+    // Every child needs its local matrices
+    for (const HierarchyNode& node : nodes) affected.push_back(node.entity);
+    for (Entity e : affected)
+    {
+        Transform* t = em.GetComponent<Transform>(e);
+        if (t != nullptr) Queue(t, e.Index());
+    }
+}
+
+void TransformSystem::BakeStaticScene(EntityManager& em)
+{
+    staticScene.Clear();
+    for (auto [e, mesh, t, isStatic] : em.GetView<Mesh, Transform, Static>(Without<Camera>()))
+    {
+        // Move the center of the mesh's box into world space, and grow its half extents by how
+        // much each local axis reaches along each world axis
+        float center[3];
+        float extent[3];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            center[axis] = ((&mesh.boundingMin.x)[axis] + (&mesh.boundingMax.x)[axis]) * 0.5f;
+            extent[axis] = ((&mesh.boundingMax.x)[axis] - (&mesh.boundingMin.x)[axis]) * 0.5f;
+        }
+
+        StaticScene::Bounds bounds;
+        for (int col = 0; col < 3; col++)
+        {
+            float worldCenter = t.worldMatrix.m[3][col];
+            float worldExtent = 0;
+            for (int row = 0; row < 3; row++)
+            {
+                worldCenter += center[row] * t.worldMatrix.m[row][col];
+                worldExtent += extent[row] * std::fabs(t.worldMatrix.m[row][col]);
+            }
+            bounds.min[col] = worldCenter - worldExtent;
+            bounds.max[col] = worldCenter + worldExtent;
+        }
+        staticScene.Add(e, bounds);
+    }
+    staticScene.Build();
+    staticsChanged = false;
 }
 
-void TransformSystem::Update(float dt)
+int TransformSystem::DepthOf(EntityManager& em, Entity entity)
 {
-    EntityManager& em = EntityManager::GetInstance();
-    auto allTransforms = em.GetAllComponentsOfType<Transform>();
+    // Depths are INVALID_INDEX until known, and PATH while the entity is on the chain being climbed
+    const int PATH = -2;
 
-    for (int i = 0; i < allTransforms.size(); i++)
+    // Climb until an entity whose depth is known, one with no parent, or one already on the chain
+    path.clear();
+    Entity current = entity;
+    int depth;
+    while (true)
     {
-        auto component = allTransforms[i];
-        if (component->ID() == INVALID_COMPONENT) continue;
-        auto t = (Transform*)component;
-        if (!t->matricesDirty) continue;
+        int known = depths[current.Index()];
+        if (known >= 0)
+        {
+            depth = known;
+            break;
+        }
+        // A loop of parents, the last entity climbed becomes a root
+        if (known == PATH)
+        {
+            depth = -1;
+            break;
+        }
 
-        UpdateMatrices(t);
+        // Cameras' transforms belong to CameraControl, which runs alongside this system, so
+        // nothing hangs off them
+        Parent* parent = em.GetComponent<Parent>(current);
+        if (parent == nullptr || !em.IsAlive(parent->entity) || em.HasComponent<Camera>(parent->entity))
+        {
+            depths[current.Index()] = 0;
+            depth = 0;
+            break;
+        }
 
-        CalculateUp(t);
-        CalculateRight(t);
-        CalculateForward(t);
+        depths[current.Index()] = PATH;
+        path.push_back(current.Index());
+        current = parent->entity;
     }
+
+    for (auto it = path.rbegin(); it != path.rend(); ++it) depths[*it] = ++depth;
+    return depths[entity.Index()];
+}
+
+void TransformSystem::UpdateMatrices(Transform* transform)
+{
+    // The same math the batched update does, for a batch of one
+    thread_local TransformBatch single;
+    single.Clear();
+    single.Add(&transform->position.x, &transform->pitchYawRoll.x, &transform->scale.x);
+    single.Compose();
+
+    single.GetWorldMatrix(0, &transform->worldMatrix.m[0][0]);
+    single.GetWorldInverseTransposeMatrix(0, &transform->worldInverseTransposeMatrix.m[0][0]);
+    single.GetWorldInverseMatrix(0, &transform->worldInverseMatrix.m[0][0]);
+    single.GetRotation(0, &transform->rotation.x);
+    single.GetBasis(0, &transform->right.x, &transform->up.x, &transform->forward.x);
+    transform->matricesDirty = false;
 }
 
 void TransformSystem::MoveAbsolute(Transform* transform, float x, float y, float z)
@@ -103,9 +355,11 @@ void TransformSystem::MoveAbsolute(Transform* transform, float x, float y, float
 
 void TransformSystem::MoveRelative(Transform* transform, float x, float y, float z)
 {
-    XMVECTOR rotatedVector = XMVector3Rotate(
-        XMVectorSet(x, y, z, 0),
-        XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&transform->pitchYawRoll)));
+    // The cached quaternion is stale once the transform is dirty, the rotation may have changed
+    XMVECTOR rotation = transform->matricesDirty
+        ? XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&transform->pitchYawRoll))
+        : XMLoadFloat4(&transform->rotation);
+    XMVECTOR rotatedVector = XMVector3Rotate(XMVectorSet(x, y, z, 0), rotation);
 
     // Overwrite position with current pos + rotated movement
     XMStoreFloat3(
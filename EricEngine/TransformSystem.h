@@ -1,25 +1,138 @@
 #pragma once
 
 #include "Transform.h"
+#include "Parent.h"
+#include "Static.h"
+#include "StaticScene.h"
+#include "EntityManager.h"
+#include "TransformBatch.h"
+#include <cstdint>
+#include <vector>
+
+// Updates with fewer dirty transforms than this stay on the calling thread
+#define TRANSFORM_PARALLEL_THRESHOLD 4096
+// Transforms per job, a multiple of 8 so every job fills whole AVX2 registers
+#define TRANSFORM_JOB_SIZE 1024
 
 class TransformSystem
 {
 public:
-    void Update(float dt);
-    TransformSystem();
+    // Entities with a Camera are skipped entirely. CameraControl moves them and builds their matrices
+    // with UpdateMatrices, so the two systems can run at the same time. A camera's Parent is ignored,
+    // and so is a camera as anyone's parent. em has to be the one the system was made for
+    void Update(ECS::EntityManager& em, float dt);
+
+    // Registers the observers that notice static changes with em, the destructor removes them,
+    // so em has to outlive the system
+    TransformSystem(ECS::EntityManager& em);
+    ~TransformSystem();
+    TransformSystem(const TransformSystem&) = delete;
+    TransformSystem& operator=(const TransformSystem&) = delete;
+
+    // Below threshold dirty transforms, Update does all the work itself. Above it, the matrices are
+    // built in jobs on the JobSystem, and so is each depth level of the hierarchy. Either way the
+    // results are identical
+    void SetParallelThreshold(int threshold) { parallelThreshold = threshold; }
+
+    // World bounds of every static entity with a mesh, as of the last bake. Static transforms are
+    // baked on the first update and again whenever a static transform, mesh or tag changes, and
+    // skipped otherwise, so each update only costs as much as the dynamic transforms that moved
+    const StaticScene& GetStaticScene() const { return staticScene; }
 
 private:
-    void CalculateUp(Transform* transform);
-    void CalculateRight(Transform* transform);
-    void CalculateForward(Transform* transform);
-    void UpdateMatrices(Transform* transform);
+    // Tick of the last Update, transforms changed before it are already up to date
+    uint32_t lastUpdateTick;
+    // Counts updates, to stamp what moved in each one
+    uint32_t updateCount;
+
+    struct DirtyTransform
+    {
+        Transform* transform;
+        uint32_t entityIndex;
+        // Position in nodes if the entity has a parent, otherwise INVALID_INDEX
+        int node;
+    };
+
+    // Dirty transforms are gathered here each update, accessed like dirty[slot] for batch slot
+    TransformBatch batch;
+    std::vector<DirtyTransform> dirty;
+    int parallelThreshold;
+
+    // An entity with a Parent. Its world matrices are its local ones times its parent's
+    struct HierarchyNode
+    {
+        ECS::Entity entity = ECS::INVALID_ENTITY;
+        ECS::Entity parent = ECS::INVALID_ENTITY;
+        DirectX::XMFLOAT4X4 localMatrix = {};
+        DirectX::XMFLOAT4X4 localInverseTransposeMatrix = {};
+        // updateCount when the local matrices were last built
+        uint32_t composed = 0;
+    };
+
+    // Every child, sorted by depth so a single sweep always reaches a parent before its children.
+    // Depth level d is nodes [levelStarts[d], levelStarts[d + 1]), the children of roots are level 0
+    std::vector<HierarchyNode> nodes;
+    std::vector<int> levelStarts;
+    // Accessed like nodeOf[entityIndex], that entity's position in nodes or INVALID_INDEX
+    std::vector<int> nodeOf;
+    // Parent pool size when nodes was built, so removed parents are noticed
+    int builtParentCount;
+
+    // Accessed like movedStamp[entityIndex], the updateCount when that entity's world matrix last changed
+    std::vector<uint32_t> movedStamp;
+    // Accessed like queuedStamp[entityIndex], the updateCount when that entity was last put in batch
+    std::vector<uint32_t> queuedStamp;
+
+    StaticScene staticScene;
+    // Set when the static scene needs a bake on the next update
+    bool staticsChanged;
+    // The EntityManager the static observers are registered with, and their ids to remove them
+    ECS::EntityManager* observed;
+    std::vector<ECS::ObserverID> observers;
+
+    // Rebuilds the static scene from the static transforms' finished world matrices
+    void BakeStaticScene(ECS::EntityManager& em);
+
+    // Accessed like depths[entityIndex] while building, and the entities on the chain being climbed
+    std::vector<int> depths;
+    std::vector<uint32_t> path;
+
+    // Rebuilds nodes if a Parent was added, removed or changed since the last update. Every entity
+    // that was or is a child is queued, since its matrices mean something different now
+    void UpdateHierarchy(ECS::EntityManager& em, uint32_t since);
+    // How many parents up entity's chain goes. An entity whose parent is gone, or that closes a
+    // loop of parents, counts as a root
+    int DepthOf(ECS::EntityManager& em, ECS::Entity entity);
+
+    // Adds a transform to batch and marks it clean, once per update
+    void Queue(Transform* transform, uint32_t entityIndex);
+    // Composes batch slots [first, last) and copies the results into their transforms,
+    // or their nodes for children
+    void UpdateRange(int first, int last);
+    // Rebuilds the world matrices of nodes [first, last) whose local matrices or parent moved
+    void PropagateRange(const ECS::EntityManager& em, ECS::ComponentPool<Transform>& transforms, int first, int last);
 
 public:
+    // The setters below only edit the transform and mark its matrices dirty, they don't log a change.
+    // Update only visits transforms changed since it last ran, so for a transform owned by an
+    // EntityManager the caller has to fetch it with GetComponentForWrite or call MarkChanged<Transform>
+    // on it, or the edit is never picked up. A transform that isn't in an EntityManager yet, like one
+    // about to go in a Prefab, needs neither, being added counts as a change
+
+    // Moves by x, y, z in world space. Log the change, see above
     static void MoveAbsolute(Transform* transform, float x, float y, float z);
+    // Moves by x, y, z along the transform's own axes. Log the change, see above
     static void MoveRelative(Transform* transform, float x, float y, float z);
+    // Adds to the pitch, yaw and roll. Log the change, see above
     static void Rotate(Transform* transform, float pitch, float yaw, float roll);
 
+    // Replaces the pitch, yaw and roll. Log the change, see above
     static void SetPitchYawRoll(Transform* transform, float pitch, float yaw, float roll);
+    // Replaces the scale. Log the change, see above
     static void SetScale(Transform* transform, float x, float y, float z);
+    // Replaces the position. Log the change, see above
     static void SetPosition(Transform* transform, float x, float y, float z);
+
+    // Builds one transform's matrices, rotation and basis vectors right away, with the same math as Update
+    static void UpdateMatrices(Transform* transform);
 };
\ No newline at end of file
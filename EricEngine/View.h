@@ -0,0 +1,156 @@
+#pragma once
+
+#include <vector>
+#include <tuple>
+#include <algorithm>
+#include "Entity.h"
+#include "ComponentPool.h"
+#include "TagPool.h"
+#include "Components.h"
+
+namespace ECS
+{
+    // Passed to a query to leave out entities that have any of ComponentTypes:
+    //     em.GetView<Mesh, Transform>(Without<RaycastObject>())
+    template <class... ComponentTypes>
+    struct Without
+    {
+        static constexpr Signature signature = SignatureOf<ComponentTypes...>;
+    };
+
+    // Passed to a query to only visit entities whose ComponentType was added or marked
+    // changed at tick since or later:
+    //     em.GetView<Transform>(Changed<Transform>(lastUpdateTick))
+    template <class ComponentType>
+    struct Changed
+    {
+        uint32_t since;
+        explicit Changed(uint32_t since) : since(since) {}
+    };
+
+    // Like Changed, but only for components added at tick since or later
+    template <class ComponentType>
+    struct Added
+    {
+        uint32_t since;
+        explicit Added(uint32_t since) : since(since) {}
+    };
+
+    // A lazy query over every entity that has all of ComponentTypes. Nothing is
+    // gathered up front: iterating walks the smallest of the pools involved (or a
+    // cached query's entity list) and checks each entity's signature in place, so
+    // making and iterating a view never allocates.
+    //
+    // Iterating yields std::tuple<Entity, ComponentTypes&...>, so it works with
+    // structured bindings:
+    //     for (auto [e, mesh, transform] : em.GetView<Mesh, Transform>()) { ... }
+    //
+    // Don't add or remove the viewed component types while iterating, or mark
+    // the component a Changed view follows as changed.
+    template <class... ComponentTypes>
+    class View
+    {
+    public:
+        class Iterator
+        {
+        public:
+            Iterator(const View* view, int position) : view(view), position(position), components()
+            {
+                SkipToMatch();
+            }
+
+            std::tuple<Entity, ComponentTypes&...> operator*() const
+            {
+                int index = (*view->driver)[position];
+                return std::tuple<Entity, ComponentTypes&...>(
+                    Entity::Make(index, (*view->generations)[index]),
+                    *std::get<ComponentTypes*>(components)...);
+            }
+
+            Iterator& operator++()
+            {
+                position++;
+                SkipToMatch();
+                return *this;
+            }
+
+            bool operator==(const Iterator& other) const { return position == other.position; }
+            bool operator!=(const Iterator& other) const { return position != other.position; }
+
+        private:
+            const View* view;
+            int position;
+            // The current entity's components, looked up once it's known to match
+            std::tuple<ComponentTypes*...> components;
+
+            // Moves forward until the entity at position has every component and no excluded ones.
+            // Rejecting an entity only costs one signature test, no pool lookups
+            void SkipToMatch()
+            {
+                int end = view->End();
+                for (; position < end; position++)
+                {
+                    int index = (*view->driver)[position];
+                    if (index == INVALID_INDEX) continue;
+                    if (((*view->signatures)[index] & view->mask) != view->required) continue;
+
+                    components = std::make_tuple(std::get<PoolFor<ComponentTypes>*>(view->pools)->Get(index)...);
+                    return;
+                }
+            }
+        };
+
+        // Walks driver from position first if one is given, otherwise whichever pool has the
+        // fewest components. Entities whose signature overlaps excluded are skipped
+        View(const std::vector<uint32_t>* generations, const std::vector<Signature>* signatures, Signature excluded,
+            const std::vector<int>* driver, int first, PoolFor<ComponentTypes>*... pools)
+            : pools(pools...), generations(generations), signatures(signatures), driver(driver), first(first), last(-1),
+            required(SignatureOf<ComponentTypes...>), mask(SignatureOf<ComponentTypes...> | excluded)
+        {
+            static_assert((!IsTag<ComponentTypes> || ...), "A view needs at least one component type with data to walk, use ForEachTagged for tags");
+
+            if (driver != nullptr) return;
+
+            // Tags have no list of entities to walk, they're only checked through the signature
+            auto consider = [&](const auto* pool) {
+                if constexpr (!IsTag<typename std::decay_t<decltype(*pool)>::Type>)
+                {
+                    if (this->driver == nullptr || pool->Size() < (int)this->driver->size()) this->driver = &pool->Entities();
+                }
+            };
+            (consider(pools), ...);
+        }
+
+        Iterator begin() const { return Iterator(this, first); }
+        Iterator end() const { return Iterator(this, End()); }
+
+        // Upper bound on how many entities this view can yield
+        int SizeHint() const { return End() - first; }
+
+        // The part of this view that walks driver positions [from, to) relative to where it starts.
+        // Slices of one view don't overlap, so they can be walked on different threads
+        View Slice(int from, int to) const
+        {
+            View slice = *this;
+            slice.first = first + from;
+            slice.last = (std::min)(first + to, End());
+            return slice;
+        }
+
+    private:
+        std::tuple<PoolFor<ComponentTypes>*...> pools;
+        const std::vector<uint32_t>* generations;
+        const std::vector<Signature>* signatures;
+        // Entity indices to walk, every match is somewhere in this list at or after first.
+        // Entries can be INVALID_INDEX, those are skipped
+        const std::vector<int>* driver;
+        int first;
+        // Position to stop at, or -1 to walk to the end of driver
+        int last;
+
+        int End() const { return last < 0 ? (int)driver->size() : last; }
+        // An entity matches when (signature & mask) == required
+        Signature required;
+        Signature mask;
+    };
+}
@@ -19,6 +19,8 @@
 #include "Raycasting.h"
 #include "RaycastObject.h"
 #include "TransformSystem.h"
+#include "Scheduler.h"
+#include "JobSystem.h"
 
 #include <Windows.h>
 #include <memory>
@@ -191,15 +193,6 @@ HRESULT main(HINSTANCE hInstance, int nCmdShow)
     hr = mw.InitializeWindow();
     if (FAILED(hr)) return hr;
 
-    // Assign an id to all component types
-    // Mesh needs to be registered first......  would like to find a better solution
-    EntityManager::RegisterNewComponentType<Mesh>();
-    EntityManager::RegisterNewComponentType<Transform>();
-    EntityManager::RegisterNewComponentType<Material>();
-    EntityManager::RegisterNewComponentType<Camera>();
-    EntityManager::RegisterNewComponentType<LightComponent>();
-    EntityManager::RegisterNewComponentType<RaycastObject>();
-
     // Create and initialize D3D11
     std::shared_ptr<D3DResources> d3dResources = std::make_shared<D3DResources>(WIDTH, HEIGHT);
     d3dResources->Initialize(mw.GetWindow());
@@ -208,39 +201,56 @@ HRESULT main(HINSTANCE hInstance, int nCmdShow)
     InitializeImGui(mw.GetWindow(), d3dResources->GetDevice(), d3dResources->GetContext());
 #endif
 
+    // Start the worker threads. The job system treats whichever thread makes it as the main thread
+    JobSystem* jobSystem = &JobSystem::GetInstance();
+
+    // The live world, everything the systems below update and draw
+    EntityManager* em = new EntityManager();
+
     // Create asset manager
     AssetManager* assetManager = new AssetManager(d3dResources);
     // Create scene loader
-    SceneLoader* sceneLoader = new SceneLoader(assetManager);
+    SceneLoader* sceneLoader = new SceneLoader(em, assetManager);
 
 #if _DEBUG
     // Create scene editor
-    SceneEditor sceneEditor(sceneLoader, assetManager);
+    SceneEditor sceneEditor(em, sceneLoader, assetManager);
 #endif
 
-    TransformSystem transformSystem;
+    // Held by pointer so it can be destroyed, taking its observers off em, before em is deleted
+    std::unique_ptr<TransformSystem> transformSystem = std::make_unique<TransformSystem>(*em);
 
     // Create Camera
-    Camera* camera = new Camera();
-    camera->movementSpeed = 10;
-    camera->mouseLookSpeed = 1;
-    camera->fieldOfView = 3.14f / 3.0f;
-    camera->aspectRatio = 16.0f / 9.0f;
-    camera->orthoSize = 2.5f;
-    Transform* camTransform = new Transform();
-    TransformSystem::SetPosition(camTransform, 0, 20, 30);
+    Camera camera = Camera();
+    camera.movementSpeed = 10;
+    camera.mouseLookSpeed = 1;
+    camera.fieldOfView = 3.14f / 3.0f;
+    camera.aspectRatio = 16.0f / 9.0f;
+    camera.orthoSize = 2.5f;
+    Transform camTransform;
+    TransformSystem::SetPosition(&camTransform, 0, 20, 30);
 
     // ---------------- initialize systems ----------------
     std::unique_ptr<Renderer> renderer = std::make_unique<Renderer>(d3dResources, assetManager);
     CameraControl camControl = CameraControl(mw.GetWindow(), WIDTH, HEIGHT);
-    Raycasting raycasting = Raycasting();
+    Raycasting raycasting = Raycasting(&transformSystem->GetStaticScene());
+
+    // Systems that touch the same components run in this order, the rest run in parallel.
+    // Transforms and CameraControl split the transforms between them, so they run together
+    Scheduler scheduler(*em);
+    scheduler.AddSystem("Transforms", SystemAccess().Read<Parent, Static, Mesh>().Write<Transform>().OnlyWithout<Camera>(),
+        [&](EntityManager& world, float dt) { transformSystem->Update(world, dt); });
+    scheduler.AddSystem("CameraControl", SystemAccess().Write<Camera, Transform>().OnlyWith<Camera>(),
+        [&](EntityManager& world, float dt) { camControl.Update(world, dt); });
+    scheduler.AddSystem("Raycasting", SystemAccess().Read<Mesh, Transform, Camera, RaycastObject, Static>().Write<Material>(),
+        [&](EntityManager& world, float dt) { raycasting.Update(world, dt); });
+    scheduler.AddSystem("Renderer", SystemAccess().Read<Mesh, Transform, Material, Camera, LightComponent>().OnMainThread(),
+        [&](EntityManager& world, float dt) { renderer->Render(world); });
     // ----------------------------------------------------
 
-    EntityManager* em = &EntityManager::GetInstance();
-
     // Add render camera
     {
-        int e = em->RegisterNewEntity();
+        Entity e = em->RegisterNewEntity();
         em->AddComponent(e, camera);
         em->AddComponent(e, camTransform);
     }
@@ -281,13 +291,13 @@ HRESULT main(HINSTANCE hInstance, int nCmdShow)
 #endif
 
             // ------------------ update systems ------------------
-            transformSystem.Update(dt);
-            camControl.Update(dt);
-            raycasting.Update(dt);
-            renderer->Render();
+            scheduler.Run(dt);
+            // Apply the entity changes systems recorded this frame
+            em->FlushCommands();
             // ----------------------------------------------------
 
             Input::GetInstance().EndOfFrame();
+            em->AdvanceTick();
 
             prevFrameTime = thisFrameTime;
         }
@@ -300,7 +310,9 @@ HRESULT main(HINSTANCE hInstance, int nCmdShow)
     ImGui::DestroyContext();
 #endif
 
+    transformSystem.reset();
     delete em;
     delete assetManager;
     delete sceneLoader;
+    delete jobSystem;
 }
\ No newline at end of file